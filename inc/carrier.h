@@ -0,0 +1,85 @@
+#ifndef CARRIER_H
+#define CARRIER_H
+
+// Carrier aggregation: cfg->n_carriers component carriers, each with its own
+// RB pool, SNR offset and per-UE channel. Each carrier has its own Phy and
+// RNG stream. UE geometry (path loss, shadowing) is shared; fast fading is
+// independent per carrier. UE queues stay shared.
+//
+// One TTI:
+//   1. per-carrier PHY                                        (parallel)
+//   2. each UE's backlog is split, in queue order, into per-carrier
+//      bit quotas proportional to rb_c * bits_per_rb_c,u    (serial)
+//   3. per-carrier EDF over those quotas into a grant list, reading the
+//      shared queues only                                     (parallel)
+//   4. the grants are applied to the shared queues carrier by carrier
+//                                                              (serial)
+//   5. RBs whose grant found the UE already emptied go to plain EDF
+//      over what is still queued, carrier by carrier          (serial)
+// Carrier c > 0 runs on worker thread c and carrier 0 on the caller. A
+// barrier separates the phases. Each thread writes only its own carrier's
+// data, so results do not depend on threading. With one carrier and a 0 dB
+// offset this reproduces single-carrier EDF exactly.
+
+#include "common.h"
+#include "phy.h"
+#include "scheduler.h"
+
+typedef struct CarrierSet CarrierSet;
+
+typedef struct {
+    CarrierSet *set;
+    int     idx;
+    int     rb;
+    double  snr_off_db;
+    Config  cfg;                // run config with snr_ref_db shifted by snr_off_db
+    Phy     phy;
+
+    // This TTI's channel per UE
+    int    *cqi, *bprb;
+    double *sinr_db, *perr;
+
+    // EDF over this carrier's share of each backlog
+    int    *quota;              // bits of UE u's backlog assigned here (step 2)
+    int    *off;                // backlog bits ahead of this carrier's share
+    int    *pos;                // cursor: packet index from the queue head
+    int    *pkt_left;           // cursor: bits of that packet left for this carrier
+    Grant  *grants;             // grants in allocation order (step 3)
+    int     n_grants;
+    int     rb_left;            // RBs the grants did not use (step 4)
+} Carrier;
+
+struct CarrierSet {
+    Carrier   cc[MAX_CARRIERS];
+    int       n;
+    int       num_ues;
+
+    // Work of the current phase, set by the caller before the start barrier
+    int       phase;
+    int       tti;
+    int       lazy;              // PHY only for need[u] != 0
+    unsigned char *need;         // filled by the caller in lazy mode
+    UE       *ues;
+    int      *act;               // UEs with data this TTI, ascending id
+    int       n_act;
+
+    struct CarrierThreads *thr;  // workers + phase barrier (NULL = serial)
+};
+
+// Parses "rb[:snr_off_db],..." into cfg->n_carriers / carrier_rb /
+// carrier_snr_off_db and sets cfg->rb_total to the sum. 0 on success.
+int  carrier_parse_spec(const char *spec, Config *cfg);
+
+void carrier_init(CarrierSet *cs, const Config *cfg, unsigned int seed);
+void carrier_free(CarrierSet *cs);
+
+// Step 1: advance every carrier's channel (lazy: only UEs with need[u])
+void carrier_phy(CarrierSet *cs, int tti, bool lazy);
+
+// Steps 2-5. Completions carry the channel of the carrier that finished the
+// TB; per-carrier RBs and bits go to m->ca_rb_used / ca_bits_sent.
+// Returns bits sent; *rb_used_out sums all carriers.
+int  carrier_schedule(CarrierSet *cs, UE *ues, Metrics *m, int *rb_used_out,
+                      Completion *comps, int comps_cap, int *comps_used);
+
+#endif // CARRIER_H
@@ -12,12 +12,19 @@
 
 #define DEBUG_QUEUES 0     // set to 1 if you want verbose per-TTI prints
 #define MAX_QUEUE 4096
+#define MAX_CARRIERS 8     // component carriers with carrier aggregation
 
 // ----------------- Packets -----------------
+// Times are microseconds since the start of the run (long long: an int
+// overflows after ~35 min of simulated time). The TTI index counts slots of
+// cfg.slot_us each.
+typedef enum { PKT_EMBB = 0, PKT_URLLC, PKT_CLASSES } PktClass;
+
 typedef struct {
     int bits;           // remaining payload (bits)
-    int arrival_tti;    // when it arrived
-    int deadline_tti;   // absolute deadline TTI
+    int cls;            // PktClass
+    long long arrival_us;   // when it arrived
+    long long deadline_us;  // absolute deadline
 } Packet;
 
 // ----------------- UE -----------------
@@ -27,6 +34,7 @@ typedef struct {
     Packet *q;                  // circular buffer
     int q_head, q_tail, q_count;
     long long bits_sent_total;
+    long long bits_delivered;   // bits ACKed (goodput)
     long long pkts_delivered;
     long long pkts_missed;
 
@@ -37,23 +45,45 @@ typedef struct {
 
     // debug (per TTI)
     int dbg_tx_bits_this_tti;
+    int dbg_rb_this_tti;
     int dbg_was_scheduled;
 } UE;
 
 // ----------------- Config -----------------
 typedef struct {
     int ttis;               // total simulation length
-    int rb_total;           // total RBs per TTI (capacity / energy proxy)
+    int rb_total;           // total RBs per slot (capacity / energy proxy)
     int num_ues;            // number of UEs
     unsigned int seed;      // rng seed
-    double arrival_rate;    // probability of one packet arrival per UE per TTI (Bernoulli)
+    double arrival_rate;    // eMBB arrivals per UE per ms (Bernoulli per slot)
     int pkt_bits_min;       // min packet size (bits)
     int pkt_bits_max;       // max packet size (bits)
-    int deadline_ttis;      // relative deadline (TTIs after arrival)
+    int deadline_us;        // relative eMBB deadline (us after arrival)
     double bler;            // base BLER for HARQ success (0.0..1.0) [legacy mode]
-    int harq_rtt;           // HARQ round-trip in TTIs
-    const char *out_dir;    // (unused for now)
-    const char *csv_path;
+    int harq_rtt_us;        // HARQ round-trip (us after the TX start)
+    const char *out_dir;    // directory for enabled log streams
+    const char *csv_path;   // explicit schedule log path (implies schedule stream)
+    const char *summary_path; // JSON summary of streaming metrics (NULL = off)
+
+    // -------- Log controls --------
+    int    log_streams;       // LOG_* bits (see trace.h), 0 = no CSV streams
+    const char *log_ues;      // UE subset, e.g. "0-7,12" (NULL = all)
+    int    log_every;         // snapshot streams: log every Nth TTI
+    int    log_sample;        // events: reservoir size (0 = log all events)
+
+    // -------- Numerology / URLLC --------
+    int    slot_us;           // slot duration: 1000 >> mu for NR numerology mu
+    int    minislot_syms;     // mini-slot length in symbols (2/4/7), 0 = slots only
+    double urllc_rate;        // URLLC arrivals per UE per ms (0 = no URLLC traffic)
+    int    urllc_bits;        // URLLC packet size (bits)
+    int    urllc_deadline_us; // relative URLLC deadline (us)
+    int    preempt;           // 1 = mini-slots may puncture eMBB TBs of the slot
+
+    // -------- External scheduler --------
+    const char *ext_shm;      // POSIX shm name; NULL = built-in EDF
+    int    ext_timeout_ms;    // per-TTI wait for grants before falling back to EDF
+
+    int    step_generic;      // 1 = use the unspecialised sim_step (benchmarking)
 
     // -------- PHY / channel model params --------
     int    phy_mode;          // 0 = legacy (random-walk CQI + fixed BLER), 1 = channel-based
@@ -62,27 +92,87 @@ typedef struct {
     double fading_rho;        // AR(1) coefficient (0..1)
     double snr_ref_db;        // reference SNR (median) in dB
     double rb_floor_perr;     // minimum RB error probability (e.g., 1e-4)
+    int    phy_pipeline;      // 1 = compute TTI t+1's channel on a helper thread
+    int    phy_lazy;          // 1 = only evaluate UEs with data (AR(1) catch-up)
+
+    // -------- MU-MIMO --------
+    int    mu_mimo;           // 1 = pair UEs with low spatial correlation on shared RBs
+    double mu_corr_th;        // max |h_i^H h_j| for co-scheduling (0..1)
+    int    mu_cand_max;       // partner candidates: K earliest-deadline UEs
+
+    // -------- Profiling --------
+    int    perf_counters;     // 1 = per-stage hardware counters / timing in the summary
+
+    // -------- Carrier aggregation (needs phy_mode 1) --------
+    int    n_carriers;                        // 0 = one carrier of rb_total RBs
+    int    carrier_rb[MAX_CARRIERS];          // RBs per slot; rb_total is the sum
+    double carrier_snr_off_db[MAX_CARRIERS];  // SNR offset vs snr_ref_db
 } Config;
 
+// ----------------- Streaming aggregates -----------------
+// HDR-style log-linear histogram: values below 2*LAT_SUB are exact, every
+// power-of-two range above that is split into LAT_SUB linear sub-buckets
+// (~6% relative error). Covers 0..2^LAT_MAX_BITS with fixed memory.
+#define LAT_SUB_BITS 4
+#define LAT_SUB      (1 << LAT_SUB_BITS)
+#define LAT_MAX_BITS 40
+#define LAT_BUCKETS  ((LAT_MAX_BITS - LAT_SUB_BITS + 1) * LAT_SUB)
+
+typedef struct {
+    long long count;
+    long long max;
+    uint32_t  b[LAT_BUCKETS];
+} LatHist;
+
+// Windowed time series with fixed slot count: when all slots are full,
+// neighbours are merged pairwise and the window width doubles.
+#define TS_SLOTS 256
+
+typedef struct {
+    int win;                    // TTIs per slot
+    int n;                      // completed slots
+    int fill;                   // TTIs accumulated in the open slot
+    long long rb[TS_SLOTS];     // RBs used per slot (slot n is open)
+    long long q[TS_SLOTS];      // summed queue depth per slot
+} TimeSeries;
+
 // ----------------- Metrics -----------------
 typedef struct {
     long long total_bits_sent;
     long long total_packets;
     long long deadline_misses;
     double    avg_latency;          // not directly used
-    long long sum_latency;          // accumulate latency (TTIs) of delivered pkts
+    long long sum_latency;          // accumulate latency (us) of delivered pkts
 
     long long rb_used_total;        // for utilization
+    long long mu_pairs;             // MU-MIMO co-scheduled pairs
+    long long preempted;            // eMBB TBs punctured by URLLC mini-slots
+    long long ca_rb_used[MAX_CARRIERS];   // per component carrier
+    long long ca_bits_sent[MAX_CARRIERS];
+
+    long long cls_packets[PKT_CLASSES];  // arrivals per packet class
+    long long cls_misses[PKT_CLASSES];   // deadline misses / drops per class
+
+    // Histograms count latency in units of lat_unit_us (the grid all
+    // latencies fall on, so slot-only runs keep exact quantiles)
+    int        lat_unit_us;
+    LatHist    lat;                 // latency of delivered pkts
+    LatHist    cls_lat[PKT_CLASSES];
+    LatHist   *ue_lat;              // per-UE latency, array size = num_ues
+    int        num_ues;
+    TimeSeries ts;                  // utilization / queue depth over time
 } Metrics;
 
 // ----------------- HARQ feedback event -----------------
 typedef struct {
     int ue_id;
-    int tti_feedback;      // when ACK/NACK arrives (now + harq_rtt)
-    int pkt_arrival_tti;   // for latency calc
-    int pkt_deadline_tti;  // for potential miss logic
+    long long feedback_us;     // when ACK/NACK arrives (TX start + harq_rtt_us)
+    long long pkt_arrival_us;  // for latency calc
+    long long pkt_deadline_us; // for potential miss logic
     int pkt_size_bits;     // size of the TB we just sent
+    int pkt_cls;           // PktClass
     int retx_count;        // retransmissions so far
+    int preempted;         // punctured by a URLLC mini-slot: always NACK
 
     // Context captured at transmit time (for PHY-based feedback)
     int    rb_alloc;              // RBs allocated for this TB
@@ -91,6 +181,36 @@ typedef struct {
     double rb_err_prob_at_tx;     // per-RB error probability used for this TX
 } HarqEvent;
 
+// ----------------- Per-TTI result records -----------------
+// Filled by sim_step() into buffers owned by the Sim; valid until the next step.
+// The layouts are those of L1sAlloc / L1sHarq (l1sched.h checks it), so the
+// library hands these buffers out as they are.
+
+typedef struct {
+    int32_t tti;
+    int32_t ue_id;
+    int32_t bits;           // bits transmitted this TTI
+    int32_t rb;             // RBs granted this TTI
+    int32_t cqi;
+    int32_t queue_after;    // packets left in queue after scheduling
+    int64_t hol_deadline;   // HoL deadline (us) after scheduling (0 if empty)
+} AllocRecord;
+
+typedef enum { EV_ACK = 0, EV_NACK, EV_DROP } EventKind;
+
+typedef struct {
+    int32_t tti;
+    int32_t ue_id;
+    int32_t kind;           // EventKind
+    int32_t pkt_bits;
+    int32_t retx;
+    int32_t cqi;
+    int32_t rb_alloc;
+    int32_t reserved;
+    double  sinr_db;
+    double  rb_perr;
+} HarqRecord;
+
 // ----------------- Simple RNG helpers -----------------
 static inline void rng_seed(unsigned int s) { srand(s); }
 static inline double rng_uniform01(void) { return (rand() + 1.0) / (RAND_MAX + 2.0); }
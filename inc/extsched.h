@@ -0,0 +1,137 @@
+#ifndef EXTSCHED_H
+#define EXTSCHED_H
+
+// External scheduler interface over POSIX shared memory.
+//
+// The simulator creates the segment and is the producer of the request
+// ring (one UE-state snapshot per TTI) and the consumer of the response
+// ring (RB grants). A separate local process attaches as the mirror
+// image. Both rings are single-producer/single-consumer with monotonic
+// 64-bit head/tail counters, so no locks are needed.
+//
+// Besides the per-UE summary, each request carries the first packets of
+// every queue (up to pkt_cap = min(rb_total, MAX_QUEUE), more than one
+// TTI can serve), so a client sees everything EDF would look at.
+
+#include <stdatomic.h>
+#include "common.h"
+#include "scheduler.h"
+
+#define EXT_MAGIC    0x4C314558u   // "L1EX"
+#define EXT_VERSION  4             // 2: deadlines in us, 3: 64-bit deadlines, 4: packet lists
+#define EXT_RING     4             // slots per ring (power of two)
+
+// Per-UE state published each TTI
+typedef struct {
+    int64_t hol_deadline;    // HoL deadline (us), 0 if empty
+    int64_t tail_deadline;   // deadline (us) of the newest packet
+    int32_t q_pkts;          // packets queued
+    int32_t q_bits;          // bits queued
+    int32_t hol_bits;        // remaining bits of the HoL packet
+    int32_t bprb;            // bits per RB this TTI
+    int32_t cqi;
+    float   rb_err_prob;     // per-RB error probability this TTI
+    int32_t n_pkts;          // packets listed, min(q_pkts, pkt_cap)
+    int32_t pad_;
+} ExtUEState;
+
+// Queued packet, HoL first
+typedef struct {
+    int64_t deadline;        // us
+    int32_t bits;            // remaining bits
+    int32_t pad_;
+} ExtPkt;
+
+typedef struct {
+    int32_t tti;
+    int32_t rb_budget;
+    int32_t num_ues;
+    int32_t pad_;
+    // followed by ExtUEState[num_ues], then ExtPkt[num_ues][pkt_cap]
+} ExtReq;
+
+// Grants are applied in order, so a client may grant one UE several times
+typedef struct {
+    int32_t tti;
+    int32_t num_grants;
+    // followed by Grant[grant_cap]
+} ExtResp;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  num_ues;
+    int32_t  rb_total;
+    int32_t  pkt_cap;       // ExtPkt entries per UE in a request
+    int32_t  grant_cap;     // Grant entries in a response
+    uint32_t req_bytes;     // bytes per request slot
+    uint32_t resp_bytes;    // bytes per response slot
+    _Atomic uint32_t attached;
+    _Atomic uint32_t shutdown;
+
+    _Alignas(64) _Atomic uint64_t req_head;    // advanced by client
+    _Alignas(64) _Atomic uint64_t req_tail;    // advanced by simulator
+    _Alignas(64) _Atomic uint64_t resp_head;   // advanced by simulator
+    _Alignas(64) _Atomic uint64_t resp_tail;   // advanced by client
+    // followed by EXT_RING request slots, then EXT_RING response slots
+} ExtShm;
+
+static inline int ext_pkt_cap(int rb_total) {
+    return rb_total < MAX_QUEUE ? rb_total : MAX_QUEUE;
+}
+// one grant per UE, or one per RB for a client that interleaves UEs
+static inline int ext_grant_cap(int num_ues, int rb_total) {
+    return num_ues > rb_total ? num_ues : rb_total;
+}
+static inline size_t ext_req_bytes(int num_ues, int rb_total) {
+    return (sizeof(ExtReq) + (size_t)num_ues * sizeof(ExtUEState)
+            + (size_t)num_ues * ext_pkt_cap(rb_total) * sizeof(ExtPkt) + 63) & ~(size_t)63;
+}
+static inline size_t ext_resp_bytes(int num_ues, int rb_total) {
+    return (sizeof(ExtResp) + (size_t)ext_grant_cap(num_ues, rb_total) * sizeof(Grant) + 63) & ~(size_t)63;
+}
+static inline size_t ext_shm_bytes(int num_ues, int rb_total) {
+    return ((sizeof(ExtShm) + 63) & ~(size_t)63)
+         + EXT_RING * (ext_req_bytes(num_ues, rb_total) + ext_resp_bytes(num_ues, rb_total));
+}
+static inline ExtReq *ext_req_slot(ExtShm *h, uint64_t seq) {
+    char *base = (char*)h + ((sizeof(ExtShm) + 63) & ~(size_t)63);
+    return (ExtReq*)(base + (seq & (EXT_RING - 1)) * h->req_bytes);
+}
+static inline ExtResp *ext_resp_slot(ExtShm *h, uint64_t seq) {
+    char *base = (char*)h + ((sizeof(ExtShm) + 63) & ~(size_t)63)
+               + EXT_RING * (size_t)h->req_bytes;
+    return (ExtResp*)(base + (seq & (EXT_RING - 1)) * h->resp_bytes);
+}
+static inline ExtUEState *ext_req_ues(ExtReq *r)  { return (ExtUEState*)(r + 1); }
+// packets of UE i start at ext_req_pkts(r) + i * pkt_cap
+static inline ExtPkt     *ext_req_pkts(ExtReq *r) { return (ExtPkt*)(ext_req_ues(r) + r->num_ues); }
+static inline Grant      *ext_resp_grants(ExtResp *r) { return (Grant*)(r + 1); }
+
+// Simulator side
+typedef struct {
+    ExtShm   *shm;
+    size_t    size;
+    char      name[64];
+    int       timeout_ms;   // per-TTI response timeout
+    LatHist   rtt_ns;       // publish -> grants received
+    long long timeouts;     // TTIs that fell back to built-in EDF
+    bool      no_client;    // nobody attached in time: stop waiting
+} ExtSched;
+
+int  ext_sched_open(ExtSched *x, const char *name, int num_ues, int rb_total, int timeout_ms);
+void ext_sched_close(ExtSched *x);
+
+// Publish UE state for this TTI and wait for the client's grants.
+// On success returns 0 and points *grants at the response slot (valid
+// until the next call). Returns -1 on timeout.
+int  ext_sched_exchange(ExtSched *x, const UE *ues, int num_ues, int tti, int rb_budget,
+                        const Grant **grants, int *num_grants);
+
+// Client side: attach to an existing segment (waits up to wait_ms for it)
+ExtShm *ext_client_attach(const char *name, int wait_ms, size_t *size_out);
+
+// Spin briefly, then yield: the peer may share our core
+void ext_backoff(unsigned *spins);
+
+#endif // EXTSCHED_H
@@ -0,0 +1,174 @@
+#ifndef L1SCHED_H
+#define L1SCHED_H
+
+// Embeddable simulator API (libl1sched.a / libl1sched.so.1).
+//
+// This header is self-contained: callers never see the simulator's internal
+// structs, so those can change without breaking them.
+//
+// - L1sConfig and L1sStats start with their own size. Fields are only ever
+//   appended. l1s_config_init() fills the defaults for the size the caller
+//   was compiled with, and the library defaults any field an older caller
+//   does not have.
+// - L1sAlloc and L1sHarq have frozen layouts because they are returned as
+//   arrays. New per-TTI data gets new record types and accessors.
+// - Result views point into buffers owned by the handle. They are read-only
+//   and stay valid until the next l1s_step()/l1s_run()/l1s_destroy().
+//
+// The simulator draws from the process-global C RNG, so run one instance
+// per process at a time and do not share a handle between threads.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bumped when fields or functions are added
+#define L1SCHED_API_VERSION 1
+
+#define L1S_MAX_CARRIERS 8
+
+// L1sConfig.log_streams bits
+#define L1S_LOG_SCHED   0x1     // per-UE allocations  -> schedule.csv
+#define L1S_LOG_EVENTS  0x2     // HARQ ACK/NACK/DROP  -> events.csv
+#define L1S_LOG_CHANNEL 0x4     // per-UE PHY snapshot -> channel.csv
+
+typedef struct {
+    size_t size;                // set by l1s_config_init()
+
+    // -------- API 1 --------
+    int    ttis;                // required (> 0)
+    int    rb_total;            // required (> 0) unless n_carriers > 0
+    int    num_ues;             // required (> 0)
+    unsigned int seed;
+    double arrival_rate;        // eMBB arrivals per UE per ms
+    int    pkt_bits_min, pkt_bits_max;
+    int    deadline_us;         // relative eMBB deadline
+    double bler;                // legacy mode only
+    int    harq_rtt_us;
+
+    const char *out_dir;        // directory for log_streams
+    const char *csv_path;       // schedule log path (implies L1S_LOG_SCHED)
+    int    log_streams;         // L1S_LOG_* bits
+    const char *log_ues;        // UE subset, e.g. "0-7,12" (NULL = all)
+    int    log_every;
+    int    log_sample;
+
+    int    slot_us;
+    int    minislot_syms;       // 0, 2, 4 or 7
+    double urllc_rate;          // URLLC arrivals per UE per ms
+    int    urllc_bits;
+    int    urllc_deadline_us;
+    int    preempt;
+
+    const char *ext_shm;        // external scheduler shm name (NULL = EDF)
+    int    ext_timeout_ms;
+
+    int    phy_mode;            // 0 = legacy, 1 = channel-based
+    double pathloss_exp;
+    double shadowing_std_db;
+    double fading_rho;
+    double snr_ref_db;
+    double rb_floor_perr;
+    int    phy_pipeline;
+    int    phy_lazy;
+
+    int    mu_mimo;
+    double mu_corr_th;
+    int    mu_cand_max;
+
+    int    perf_counters;
+
+    int    n_carriers;          // 0 = one carrier of rb_total RBs
+    int    carrier_rb[L1S_MAX_CARRIERS];
+    double carrier_snr_off_db[L1S_MAX_CARRIERS];
+} L1sConfig;
+
+// Frozen: one per UE scheduled in the last TTI
+typedef struct {
+    int32_t tti;
+    int32_t ue_id;
+    int32_t bits;               // bits transmitted this TTI
+    int32_t rb;                 // RBs granted this TTI
+    int32_t cqi;
+    int32_t queue_after;        // packets left after scheduling
+    int64_t hol_deadline_us;    // HoL deadline after scheduling (0 if empty)
+} L1sAlloc;
+
+enum { L1S_ACK = 0, L1S_NACK, L1S_DROP };
+
+// Frozen: one per HARQ outcome processed in the last TTI
+typedef struct {
+    int32_t tti;
+    int32_t ue_id;
+    int32_t kind;               // L1S_ACK / L1S_NACK / L1S_DROP
+    int32_t pkt_bits;
+    int32_t retx;
+    int32_t cqi;                // at TX time
+    int32_t rb_alloc;
+    int32_t reserved;
+    double  sinr_db;            // at TX time
+    double  rb_perr;
+} L1sHarq;
+
+// Running totals; the caller sets size before l1s_stats()
+typedef struct {
+    size_t size;
+
+    // -------- API 1 --------
+    int64_t ttis_done;
+    int64_t packets;            // arrivals
+    int64_t deadline_misses;    // expired or dropped after max HARQ retries
+    int64_t bits_sent;
+    int64_t rb_used;
+    int64_t mu_pairs;
+    int64_t preempted;
+    int64_t embb_packets, embb_misses;
+    int64_t urllc_packets, urllc_misses;
+    int64_t lat_p50_us, lat_p99_us, lat_p999_us, lat_max_us;
+} L1sStats;
+
+// Per-UE state; the caller sets size before l1s_ue_stats()
+typedef struct {
+    size_t size;
+
+    // -------- API 1 --------
+    int64_t bits_sent;
+    int64_t bits_delivered;     // ACKed
+    int64_t pkts_delivered;
+    int64_t pkts_missed;
+    int32_t queue_pkts;
+    int32_t cqi;
+    double  sinr_db;            // last evaluated channel
+    int64_t lat_p50_us, lat_p99_us;
+} L1sUEStats;
+
+int      l1s_api_version(void);
+
+// Defaults for every field, then cfg->size = size. Pass sizeof(L1sConfig).
+void     l1s_config_init(L1sConfig *cfg, size_t size);
+
+// Lifecycle (sim_init / sim_free equivalents). Returns NULL on bad config.
+typedef struct L1Sched L1Sched;
+
+L1Sched *l1s_create(const L1sConfig *cfg);
+void     l1s_destroy(L1Sched *h);
+
+// Simulate one TTI; returns the TTI just simulated, or -1 once cfg.ttis is reached.
+int      l1s_step(L1Sched *h);
+// Simulate all remaining TTIs (sim_run equivalent).
+void     l1s_run(L1Sched *h);
+// Next TTI to be simulated.
+int      l1s_tti(const L1Sched *h);
+
+// Views of the last stepped TTI
+const L1sAlloc *l1s_allocs(const L1Sched *h, int *count);
+const L1sHarq  *l1s_harq(const L1Sched *h, int *count);
+
+// Copy out up to out->size bytes; 0 on success, -1 on a bad size or UE id
+int      l1s_stats(const L1Sched *h, L1sStats *out);
+int      l1s_num_ues(const L1Sched *h);
+int      l1s_ue_stats(const L1Sched *h, int ue, L1sUEStats *out);
+
+void     l1s_print_summary(const L1Sched *h);
+int      l1s_write_summary(const L1Sched *h, const char *path);
+
+#endif // L1SCHED_H
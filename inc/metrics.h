@@ -3,7 +3,23 @@
 
 #include "common.h"
 
-void metrics_on_deliver(Metrics *m, const Packet *p, int now_tti, int bits_just_sent);
+// lat_unit_us: histogram resolution, a common divisor of all latencies
+void metrics_init(Metrics *m, int num_ues, int lat_unit_us);
+void metrics_free(Metrics *m);
+
+void metrics_on_deliver(Metrics *m, int ue_id, const Packet *p, long long now_us, int bits_just_sent);
 void metrics_on_miss(Metrics *m, const Packet *p);
+void metrics_on_tti(Metrics *m, int rb_used, long long queued_pkts);
+
+// Latency histogram helpers
+void      lathist_add(LatHist *h, long long v);
+long long lathist_quantile(const LatHist *h, double q);
+long long metrics_lat_us(const Metrics *m, const LatHist *h, double q);  // quantile in us
+
+// Jain's fairness index over per-UE delivered bits (1.0 = perfectly fair)
+double metrics_jain_index(const UE *ues, int num_ues);
+
+// Compact JSON summary of all streaming aggregates
+int metrics_write_json(const Metrics *m, const Config *cfg, const UE *ues, const char *path);
 
 #endif
@@ -0,0 +1,65 @@
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+// Per-stage cost of sim_step() (--perf-counters). Hardware counters are read
+// as one perf_event_open group (cycles, instructions, L1D read misses, LLC
+// misses, branch misses) of the calling thread; where the kernel refuses
+// them (containers, perf_event_paranoid, no PMU in the VM) only
+// CLOCK_MONOTONIC deltas are kept.
+//
+// Stages are delimited by perfctr_mark(): each mark charges everything since
+// the previous mark (or perfctr_start()) to its stage, so one TTI costs one
+// group read per stage boundary.
+
+#include "common.h"
+
+typedef enum {
+    PC_HARQ = 0,    // feedback processing + enqueue of this TTI's completions
+    PC_PHY,         // channel snapshot (pipeline: waiting for the helper)
+    PC_ARRIVALS,
+    PC_EXPIRY,
+    PC_SCHED,       // EDF / MU-MIMO / ext grants, mini-slots
+    PC_LOG,         // allocation records, queue metrics, all log streams
+    PC_STAGES
+} PerfStage;
+
+typedef enum {
+    PC_CYCLES = 0,
+    PC_INSTR,
+    PC_L1D_MISS,
+    PC_LLC_MISS,
+    PC_BR_MISS,
+    PC_EVENTS
+} PerfEvent;
+
+typedef struct {
+    long long ns;
+    long long ev[PC_EVENTS];
+} PerfSample;
+
+typedef struct {
+    int        hw;                  // 1 = hardware counters, 0 = clock only
+    int        leader;              // group leader fd (-1 = none)
+    int        fd[PC_EVENTS];       // -1 = event not available on this host
+    int        slot[PC_EVENTS];     // position in the group read (-1 = n/a)
+    int        n_open;
+    long long  steps;               // TTIs measured
+    long long  time_enabled, time_running; // of the group, for multiplexing
+    PerfSample last;                // reading at the previous boundary
+    PerfSample acc[PC_STAGES];      // per-stage totals
+    char       why[96];             // reason for clock-only mode
+} PerfCtr;
+
+// Returns 0 with hardware counters, -1 when falling back to clock only
+// (the PerfCtr is usable either way). A non-NULL clock_only skips the
+// counters and is reported as the reason.
+int  perfctr_open(PerfCtr *pc, const char *clock_only);
+void perfctr_close(PerfCtr *pc);
+
+void perfctr_start(PerfCtr *pc);                // start of a TTI
+void perfctr_mark(PerfCtr *pc, PerfStage st);   // end of a stage
+
+// Per-stage time/TTI and share; with counters also IPC and misses per UE per TTI
+void perfctr_print(const PerfCtr *pc, int num_ues);
+
+#endif // PERFCTR_H
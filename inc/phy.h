@@ -3,11 +3,14 @@
 
 #include "common.h"
 
+#define MU_ANT 4   // gNB antennas: length of the per-UE spatial signature
+
 // Per-UE persistent channel state (large-scale + fading state)
 typedef struct {
     double pathloss_db;
     double shadow_db;
     double fading_state;   // AR(1) state (linear, not dB)
+    int    last_tti;       // TTI fading_state belongs to (-1 = initial)
 } PhyUEState;
 
 // Per-UE instantaneous snapshot (computed each TTI)
@@ -21,16 +24,41 @@ typedef struct {
 typedef struct {
     PhyUEState *ue;  // array size = num_ues
     int num_ues;
-    // optional globals
+    uint64_t rng;    // private RNG stream: channel evolution is independent
+                     // of traffic/HARQ draws (and can run on another thread)
+
+    // MU-MIMO spatial signatures (unit-norm complex MU_ANT-vectors), stored
+    // antenna-major: sig_re[a * num_ues + ue]. NULL unless cfg->mu_mimo.
+    float *sig_re;
+    float *sig_im;
 } Phy;
 
+// Channel snapshot of all UEs for one TTI (structure of arrays)
+typedef struct {
+    int     tti;
+    double *sinr_db;
+    int    *cqi;
+    int    *bits_per_rb;
+    double *rb_err_prob;
+} PhySnapshot;
+
 // API
 void  phy_init(Phy *p, const Config *cfg, int num_ues, unsigned int seed);
 void  phy_free(Phy *p);
 void  phy_step(Phy *p, const Config *cfg, int now_tti);
+// Lazy alternative to phy_step for a single UE: jumps the AR(1) state from
+// last_tti to now_tti in one draw (rho^k decay, 1 - rho^2k innovation variance)
+void  phy_advance_ue(Phy *p, const Config *cfg, int ue_id, int now_tti);
 void  phy_get_instant(const Phy *p, const Config *cfg, int ue_id, PhyUEInstant *out);
+// CQI / bits per RB / RB error probability for a given SINR (e.g. after MU-MIMO cross-talk)
+void  phy_instant_from_sinr(const Config *cfg, double sinr_db, PhyUEInstant *out);
 void  phy_on_retx(Phy *p, int ue_id, int retx_count); // optional no-op for now
 
+// phy_step() + phy_get_instant() for every UE into a snapshot
+void  phy_snapshot_alloc(PhySnapshot *snap, int num_ues);
+void  phy_snapshot_free(PhySnapshot *snap);
+void  phy_compute_snapshot(Phy *p, const Config *cfg, int now_tti, PhySnapshot *snap);
+
 // Helpers exposed so scheduler/legacy can reuse table if desired
 int   phy_map_sinr_to_cqi(double sinr_db);
 int   phy_bits_per_rb_for_cqi(int cqi);
@@ -0,0 +1,35 @@
+#ifndef PHYPIPE_H
+#define PHYPIPE_H
+
+// Pipelined PHY: a helper thread computes the channel snapshot of TTI t+1
+// into a double buffer while the main thread schedules TTI t. The channel
+// evolution does not depend on scheduling and the PHY has its own RNG
+// stream, so results are identical to the serial order.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "common.h"
+#include "phy.h"
+
+typedef struct {
+    Phy          *phy;
+    const Config *cfg;
+    PhySnapshot   buf[2];        // buf[t & 1] holds TTI t
+    pthread_t     thread;
+    _Atomic int   produced;      // TTIs [0, produced) are ready
+    _Atomic int   consumed;      // TTIs [0, consumed) were released by main
+    _Atomic int   stop;
+    int           running;
+} PhyPipe;
+
+int  phypipe_start(PhyPipe *pp, Phy *phy, const Config *cfg);
+void phypipe_stop(PhyPipe *pp);
+
+// Main thread: wait for TTI tti's snapshot; call phypipe_release() once
+// done reading it so the helper can reuse the buffer for tti + 2. Returns
+// NULL for tti >= cfg->ttis, which the helper never produces; by then it
+// has finished with the Phy and the caller can step it serially.
+const PhySnapshot *phypipe_acquire(PhyPipe *pp, int tti);
+void phypipe_release(PhyPipe *pp, int tti);
+
+#endif // PHYPIPE_H
@@ -5,9 +5,13 @@
 
 typedef struct {
     int ue_id;
-    int pkt_arrival_tti;
-    int pkt_deadline_tti;
+    long long pkt_arrival_us;
+    long long pkt_deadline_us;
     int pkt_size_bits;
+    int pkt_cls;
+
+    long long tx_us;             // TX start (slot or mini-slot), set by the caller
+    int    preempted;            // punctured by a later mini-slot
 
     int    rb_alloc;             // RBs allocated to finish this TB now
     int    cqi_at_tx;
@@ -15,12 +19,83 @@ typedef struct {
     double rb_err_prob_at_tx;
 } Completion;
 
+// RB grant produced by an external scheduler
+typedef struct {
+    int ue_id;
+    int rb;
+} Grant;
+
+// MU-MIMO pairing state. Signatures are borrowed from the Phy; the rest is
+// per-TTI scratch so the pairing search does not allocate.
+typedef struct {
+    const Config *cfg;
+    const float  *sig_re, *sig_im;  // Phy signatures, sig[a * num_ues + ue]
+    int    num_ues;
+    float  corr_th2;                // squared correlation threshold
+    int    cand_max;                // K earliest-deadline partner candidates (0 = all)
+
+    int   *cand;                    // candidate UE ids, earliest deadline first
+    int    n_cand, cand_pad;        // count, count rounded up to the SIMD width
+    float *cre, *cim;               // gathered candidate signatures, cre[a * cand_pad + k]
+    float *corr2;                   // |h_p^H h_k|^2 per candidate
+    unsigned char *paired;          // per UE: already in a pair this TTI
+} MuMimo;
+
 // bits/RB utility (legacy table). Scheduler will prefer UE.bprb_cur if available.
 int bits_per_rb_for_cqi(int cqi);
 
 // EDF scheduler
 int schedule_edf(
-    UE *ues, int num_ues, int rb_budget, int now_tti, Metrics *m, int *rb_used_out,
+    UE *ues, int num_ues, int rb_budget, long long now_us, Metrics *m, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used
+);
+
+// EDF that also returns its allocation order as grants, one per run of
+// picks of the same UE (at most rb_budget of them). Replaying them with
+// schedule_grants on the same queues reproduces the schedule exactly.
+int schedule_edf_order(
+    UE *ues, int num_ues, int rb_budget, long long now_us, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used, Grant *order, int *num_order
+);
+
+// Apply externally computed grants (UE id, RB count) in order. Each grant
+// drains packets from the UE's head like EDF would; the total is capped
+// at rb_budget and grants for unknown UEs are ignored.
+int schedule_grants(
+    UE *ues, int num_ues, const Grant *grants, int num_grants,
+    int rb_budget, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used
+);
+
+// MU-MIMO: sig_re/sig_im come from a Phy initialised with cfg->mu_mimo
+void mu_init(MuMimo *mu, const Config *cfg, const float *sig_re, const float *sig_im, int num_ues);
+void mu_free(MuMimo *mu);
+
+// corr2[k] = |h_p^H h_k|^2 of UE p against the gathered candidates
+// cre/cim[0..cand_pad). mu_correlate uses SSE2 where available;
+// mu_correlate_scalar is the portable reference it must match.
+void mu_correlate(MuMimo *mu, int p);
+void mu_correlate_scalar(MuMimo *mu, int p);
+
+// EDF with MU-MIMO pairing: each primary may share its RBs with the
+// earliest-deadline candidate whose spatial correlation is below the
+// threshold, when the pair carries more bits per RB than the primary alone.
+// Partner RBs do not consume rb_budget; comps_cap must allow 2 x rb_budget.
+int schedule_edf_mu(
+    UE *ues, int num_ues, int rb_budget, long long now_us, Metrics *m, MuMimo *mu,
+    int *rb_used_out, Completion *comps, int comps_cap, int *comps_used
+);
+
+// Mini-slot opportunity of `syms` symbols inside a slot: URLLC HoL packets
+// are served in EDF order at syms/14 of their bits per RB. Every mini-slot
+// may use the rb_free RBs the slot-level schedule left idle. With preempt,
+// when those run out the eMBB TBs completed in this slot (comps[0..n_victims),
+// latest deadline first) are punctured: they are marked preempted (HARQ
+// NACKs them) and their RBs join *rb_preempted for the rest of the slot.
+// *rb_used_out is the RBs granted in this mini-slot.
+int schedule_minislot(
+    UE *ues, int num_ues, int syms, int rb_free, int *rb_preempted,
+    bool preempt, int n_victims, Metrics *m, int *rb_used_out,
     Completion *comps, int comps_cap, int *comps_used
 );
 
@@ -3,8 +3,24 @@
 
 #include "common.h"
 #include "phy.h"
+#include "trace.h"
+#include "scheduler.h"
+#include "extsched.h"
+#include "phypipe.h"
+#include "perfctr.h"
+#include "carrier.h"
 
+typedef struct Sim Sim;
+
+// URLLC packet arriving after the start of the current slot
 typedef struct {
+    int    ue_id;
+    Packet p;
+} PendingPkt;
+
+typedef void (*SimStepFn)(Sim *s);
+
+struct Sim {
     Config  cfg;
     int     tti;
     Metrics m;
@@ -14,18 +30,54 @@ typedef struct {
     HarqEvent *harq_events;
     int harq_cap, harq_head, harq_tail, harq_count;
 
-    // Logging
-    FILE *csv;       // per-UE schedule log
-    FILE *evcsv;     // HARQ events log
-    FILE *chcsv;     // channel log
+    // Traffic per slot (rates are per ms)
+    double      p_embb, p_urllc;       // arrival probability per UE per slot
+    PendingPkt *pend;                  // this slot's mid-slot URLLC arrivals, by time
+    int         n_pend, pend_next, pend_cap;
+
+    // Per-TTI results (reused every step, exposed read-only via l1sched.h)
+    Completion  *comps;      // each completion uses >= 1 RB (x2 MU-MIMO, + mini-slots)
+    int          comps_cap;
+    AllocRecord *allocs;     // capacity num_ues
+    int          n_allocs;
+    HarqRecord  *fb;         // HARQ outcomes processed this TTI (grows on demand)
+    int          n_fb, fb_cap;
+
+    // Logging (schedule / HARQ events / channel streams)
+    Trace trace;
 
     Phy phy;
-} Sim;
+    PhyPipe *pipe;           // PHY precompute thread (NULL = serial)
+
+    ExtSched *ext;           // external scheduler link (NULL = built-in EDF)
+    MuMimo   *mu;            // MU-MIMO pairing state (NULL = single-user EDF)
+    CarrierSet *ca;          // carrier aggregation (NULL = one carrier, s->phy)
+
+    SimStepFn step;          // sim_step variant chosen at sim_init()
+    PerfCtr  *perf;          // per-stage counters (NULL = --perf-counters off)
+    long long wall_ns;       // wall-clock time spent in sim_run()
+};
+
+// sim_config_check() results
+typedef enum {
+    CFG_OK = 0,
+    CFG_ERR_SIZE,       // ttis / rb_total / num_ues
+    CFG_ERR_TIME,       // slot_us / deadline_us / harq_rtt_us
+    CFG_ERR_MINISLOT,   // minislot_syms not 0, 2, 4 or 7
+    CFG_ERR_CARRIERS,   // n_carriers or a carrier's RBs out of range
+    CFG_ERR_CA_PHY,     // carriers without phy_mode 1
+    CFG_ERR_CA_COMBO    // carriers with ext scheduler / MU-MIMO / mini-slots
+} ConfigError;
 
+void sim_config_defaults(Config *cfg);
+// Validates and normalises cfg; CFG_OK or a ConfigError for sim_config_error()
+int  sim_config_check(Config *cfg);
+const char *sim_config_error(int err);
 void sim_init(Sim *s, const Config *cfg);
 void sim_free(Sim *s);
 void sim_step(Sim *s);
 void sim_run(Sim *s);
 void sim_print_summary(const Sim *s);
+int  sim_write_summary(const Sim *s, const char *path); // JSON, 0 on success
 
 #endif // SIM_H
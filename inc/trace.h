@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+
+// Stream bits for Config.log_streams
+#define LOG_SCHED   0x1    // per-UE allocations    -> schedule.csv
+#define LOG_EVENTS  0x2    // HARQ ACK/NACK/DROP    -> events.csv
+#define LOG_CHANNEL 0x4    // per-UE PHY snapshot   -> channel.csv
+#define LOG_ALL     (LOG_SCHED | LOG_EVENTS | LOG_CHANNEL)
+
+typedef struct {
+    FILE *sched;            // per-UE schedule log
+    FILE *ev;               // HARQ events log
+    FILE *ch;               // channel log
+
+    int every;              // log snapshot streams every Nth TTI
+    unsigned char *ue_on;   // UE subset mask (NULL = all UEs)
+    int num_ues;
+
+    // Reservoir sample of events (res_cap == 0 -> log every event)
+    HarqRecord *res;
+    int        res_cap;
+    long long  res_seen;
+    uint64_t   rng;         // private stream, keeps sim RNG untouched
+} Trace;
+
+// Parse "sched,events,channel" / "all" / "none" into LOG_* bits; -1 on error
+int  trace_parse_streams(const char *spec);
+
+void trace_open(Trace *t, const Config *cfg);
+void trace_close(Trace *t);   // flushes the event reservoir
+
+static inline bool trace_tti_on(const Trace *t, int tti) {
+    return t->every <= 1 || tti % t->every == 0;
+}
+static inline bool trace_ue_on(const Trace *t, int ue) {
+    return !t->ue_on || t->ue_on[ue];
+}
+
+void trace_event(Trace *t, const HarqRecord *e);
+void trace_sched(Trace *t, const AllocRecord *a);
+void trace_channel(Trace *t, int tti, int ue, double sinr_db, int cqi, int bits_per_rb, double rb_err_prob);
+
+#endif // TRACE_H
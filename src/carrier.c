@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include "carrier.h"
+#include <pthread.h>
+
+enum { CA_PHY = 0, CA_EDF, CA_STOP };
+
+int carrier_parse_spec(const char *spec, Config *cfg) {
+    int n = 0, total = 0;
+    const char *p = spec;
+    while (*p) {
+        if (n == MAX_CARRIERS) return -1;
+        char *end;
+        long rb = strtol(p, &end, 10);
+        if (end == p || rb <= 0) return -1;
+        double off = 0.0;
+        p = end;
+        if (*p == ':') {
+            off = strtod(p + 1, &end);
+            if (end == p + 1) return -1;
+            p = end;
+        }
+        cfg->carrier_rb[n] = (int)rb;
+        cfg->carrier_snr_off_db[n] = off;
+        total += (int)rb;
+        n++;
+        if (*p == ',') ++p;
+        else if (*p) return -1;
+    }
+    if (n == 0) return -1;
+    cfg->n_carriers = n;
+    cfg->rb_total = total;
+    return 0;
+}
+
+// ----------------- Per-carrier work -----------------
+
+static int       pkt_bits_at(const UE *u, int k)     { return u->q[(u->q_head + k) % MAX_QUEUE].bits; }
+static long long pkt_deadline_at(const UE *u, int k) { return u->q[(u->q_head + k) % MAX_QUEUE].deadline_us; }
+
+static void carrier_run_phy(CarrierSet *cs, Carrier *c) {
+    if (!cs->lazy) phy_step(&c->phy, &c->cfg, cs->tti);
+    for (int u = 0; u < cs->num_ues; ++u) {
+        if (cs->lazy) {
+            if (!cs->need[u]) continue;
+            phy_advance_ue(&c->phy, &c->cfg, u, cs->tti);
+        }
+        PhyUEInstant inst;
+        phy_get_instant(&c->phy, &c->cfg, u, &inst);
+        c->cqi[u]     = inst.cqi;
+        c->bprb[u]    = inst.bits_per_rb;
+        c->sinr_db[u] = inst.sinr_db;
+        c->perr[u]    = inst.rb_err_prob;
+    }
+}
+
+// EDF over this carrier's quotas. Each UE's cursor walks its share of the
+// backlog packet by packet, so the UE competes with the deadline of the
+// packet it would send next here; one grant per packet (part).
+static void carrier_run_edf(CarrierSet *cs, Carrier *c) {
+    c->n_grants = 0;
+    for (int i = 0; i < cs->n_act; ++i) {
+        int u = cs->act[i];
+        if (c->quota[u] <= 0) continue;
+        if (c->bprb[u] <= 0) { c->quota[u] = 0; continue; }
+        const UE *ue = &cs->ues[u];
+        int k = 0, skip = c->off[u];
+        while (skip >= pkt_bits_at(ue, k)) skip -= pkt_bits_at(ue, k++);
+        c->pos[u] = k;
+        c->pkt_left[u] = pkt_bits_at(ue, k) - skip;
+    }
+
+    int rb_left = c->rb;
+    while (rb_left > 0) {
+        // earliest deadline, ties to the lower UE id (act is ascending)
+        int best = -1;
+        long long best_d = 0;
+        for (int i = 0; i < cs->n_act; ++i) {
+            int u = cs->act[i];
+            if (c->quota[u] <= 0) continue;
+            long long d = pkt_deadline_at(&cs->ues[u], c->pos[u]);
+            if (best < 0 || d < best_d) {
+                best = u;
+                best_d = d;
+            }
+        }
+        if (best < 0) break;
+
+        const int u = best;
+        int chunk = c->pkt_left[u] < c->quota[u] ? c->pkt_left[u] : c->quota[u];
+        int rb_need = (chunk + c->bprb[u] - 1) / c->bprb[u];
+        if (rb_need <= 0) rb_need = 1;
+        int rb = rb_need <= rb_left ? rb_need : rb_left;
+        c->grants[c->n_grants++] = (Grant){ .ue_id = u, .rb = rb };
+        rb_left -= rb;
+        if (rb < rb_need) break;        // pool ran out inside this packet
+
+        c->quota[u]    -= chunk;
+        c->pkt_left[u] -= chunk;
+        if (c->pkt_left[u] == 0 && c->quota[u] > 0) {
+            c->pos[u]++;
+            c->pkt_left[u] = pkt_bits_at(&cs->ues[u], c->pos[u]);
+        }
+    }
+}
+
+static void carrier_run(CarrierSet *cs, int c) {
+    if (cs->phase == CA_PHY) carrier_run_phy(cs, &cs->cc[c]);
+    else                     carrier_run_edf(cs, &cs->cc[c]);
+}
+
+// ----------------- Threads -----------------
+
+struct CarrierThreads {
+    pthread_t         th[MAX_CARRIERS];   // th[0] unused: carrier 0 is the caller
+    pthread_barrier_t bar;                // start / end of every phase
+    pthread_mutex_t   start_mx;           // held until all workers exist
+    int               ok;                 // every worker started
+};
+
+static void *carrier_main(void *arg) {
+    Carrier *c = (Carrier*)arg;
+    CarrierSet *cs = c->set;
+    struct CarrierThreads *t = cs->thr;
+    pthread_mutex_lock(&t->start_mx);
+    int ok = t->ok;
+    pthread_mutex_unlock(&t->start_mx);
+    if (!ok) return NULL;
+
+    for (;;) {
+        pthread_barrier_wait(&t->bar);
+        if (cs->phase == CA_STOP) return NULL;
+        carrier_run(cs, c->idx);
+        pthread_barrier_wait(&t->bar);
+    }
+}
+
+// Run one phase on every carrier; returns when all are done
+static void carrier_phase(CarrierSet *cs, int phase) {
+    cs->phase = phase;
+    if (!cs->thr) {
+        for (int c = 0; c < cs->n; ++c) carrier_run(cs, c);
+        return;
+    }
+    pthread_barrier_wait(&cs->thr->bar);   // start
+    carrier_run(cs, 0);
+    pthread_barrier_wait(&cs->thr->bar);   // every carrier done
+}
+
+static void carrier_start_threads(CarrierSet *cs) {
+    cs->thr = NULL;
+    if (cs->n < 2) return;
+
+    struct CarrierThreads *t = (struct CarrierThreads*)calloc(1, sizeof(*t));
+    pthread_mutex_init(&t->start_mx, NULL);
+    pthread_mutex_lock(&t->start_mx);
+    cs->thr = t;
+    int started = 1, rc = 0;
+    for (; started < cs->n; ++started) {
+        rc = pthread_create(&t->th[started], NULL, carrier_main, &cs->cc[started]);
+        if (rc != 0) break;
+    }
+    if (rc == 0) {
+        pthread_barrier_init(&t->bar, NULL, (unsigned)cs->n);
+        t->ok = 1;
+    }
+    pthread_mutex_unlock(&t->start_mx);
+    if (rc == 0) return;
+
+    // the started workers see ok == 0 and exit
+    fprintf(stderr, "[warn] carrier thread: %s, carriers run serially\n", strerror(rc));
+    for (int c = 1; c < started; ++c) pthread_join(t->th[c], NULL);
+    pthread_mutex_destroy(&t->start_mx);
+    free(t);
+    cs->thr = NULL;
+}
+
+// ----------------- Lifecycle -----------------
+
+void carrier_init(CarrierSet *cs, const Config *cfg, unsigned int seed) {
+    memset(cs, 0, sizeof(*cs));
+    cs->n = cfg->n_carriers < MAX_CARRIERS ? cfg->n_carriers : MAX_CARRIERS;
+    cs->num_ues = cfg->num_ues;
+    const int n_ue = cfg->num_ues;
+
+    for (int k = 0; k < cs->n; ++k) {
+        Carrier *c = &cs->cc[k];
+        c->set = cs;
+        c->idx = k;
+        c->rb = cfg->carrier_rb[k];
+        c->snr_off_db = cfg->carrier_snr_off_db[k];
+        c->cfg = *cfg;
+        c->cfg.rb_total = c->rb;
+        c->cfg.snr_ref_db += c->snr_off_db;
+
+        // Carrier 0 keeps the single-carrier stream; the others only need
+        // their own fading, the UE geometry is copied from carrier 0
+        phy_init(&c->phy, &c->cfg, n_ue, seed ^ (0x9E3779B9u * (unsigned)k));
+        if (k > 0) {
+            for (int u = 0; u < n_ue; ++u) {
+                c->phy.ue[u].pathloss_db = cs->cc[0].phy.ue[u].pathloss_db;
+                c->phy.ue[u].shadow_db   = cs->cc[0].phy.ue[u].shadow_db;
+            }
+        }
+
+        c->cqi      = (int*)calloc(n_ue, sizeof(int));
+        c->bprb     = (int*)calloc(n_ue, sizeof(int));
+        c->sinr_db  = (double*)calloc(n_ue, sizeof(double));
+        c->perr     = (double*)calloc(n_ue, sizeof(double));
+        c->quota    = (int*)calloc(n_ue, sizeof(int));
+        c->off      = (int*)calloc(n_ue, sizeof(int));
+        c->pos      = (int*)calloc(n_ue, sizeof(int));
+        c->pkt_left = (int*)calloc(n_ue, sizeof(int));
+        c->grants   = (Grant*)calloc(c->rb, sizeof(Grant));   // each grant >= 1 RB
+    }
+    cs->need = (unsigned char*)calloc(n_ue, 1);
+    cs->act  = (int*)calloc(n_ue, sizeof(int));
+
+    carrier_start_threads(cs);
+}
+
+void carrier_free(CarrierSet *cs) {
+    if (cs->thr) {
+        struct CarrierThreads *t = cs->thr;
+        cs->phase = CA_STOP;
+        pthread_barrier_wait(&t->bar);
+        for (int c = 1; c < cs->n; ++c) pthread_join(t->th[c], NULL);
+        pthread_barrier_destroy(&t->bar);
+        pthread_mutex_destroy(&t->start_mx);
+        free(t);
+        cs->thr = NULL;
+    }
+    for (int k = 0; k < cs->n; ++k) {
+        Carrier *c = &cs->cc[k];
+        phy_free(&c->phy);
+        free(c->cqi);
+        free(c->bprb);
+        free(c->sinr_db);
+        free(c->perr);
+        free(c->quota);
+        free(c->off);
+        free(c->pos);
+        free(c->pkt_left);
+        free(c->grants);
+    }
+    free(cs->need);
+    free(cs->act);
+    memset(cs, 0, sizeof(*cs));
+}
+
+// ----------------- One TTI -----------------
+
+void carrier_phy(CarrierSet *cs, int tti, bool lazy) {
+    cs->tti = tti;
+    cs->lazy = lazy;
+    carrier_phase(cs, CA_PHY);
+}
+
+static void carrier_set_channel(const Carrier *c, UE *u) {
+    u->cqi             = c->cqi[u->id];
+    u->bprb_cur        = c->bprb[u->id];
+    u->sinr_db_cur     = c->sinr_db[u->id];
+    u->rb_err_prob_cur = c->perr[u->id];
+}
+
+// Step 2: each backlog, in queue order, is cut into consecutive per-carrier
+// shares weighted by the carrier's capacity for that UE (rb_c * bprb_c,u)
+static void carrier_split(CarrierSet *cs) {
+    cs->n_act = 0;
+    for (int u = 0; u < cs->num_ues; ++u) {
+        const UE *ue = &cs->ues[u];
+        if (ue->q_count == 0) continue;
+        cs->act[cs->n_act++] = u;
+
+        long long backlog = 0;
+        for (int k = 0; k < ue->q_count; ++k) backlog += pkt_bits_at(ue, k);
+
+        long long w[MAX_CARRIERS], wsum = 0;
+        for (int c = 0; c < cs->n; ++c) {
+            w[c] = (long long)cs->cc[c].rb * cs->cc[c].bprb[u];
+            wsum += w[c];
+        }
+        long long off = 0;
+        for (int c = 0; c < cs->n; ++c) {
+            long long q = (c == cs->n - 1) ? backlog - off
+                        : (wsum > 0 ? backlog * w[c] / wsum : 0);
+            cs->cc[c].off[u]   = (int)off;
+            cs->cc[c].quota[u] = (int)q;
+            off += q;
+        }
+    }
+}
+
+int carrier_schedule(CarrierSet *cs, UE *ues, Metrics *m, int *rb_used_out,
+                     Completion *comps, int comps_cap, int *comps_used) {
+    cs->ues = ues;
+    carrier_split(cs);
+    carrier_phase(cs, CA_EDF);
+
+    // Step 4: apply the grants carrier by carrier. Grants drain from the
+    // queue head, so bits an earlier carrier had no room for are sent by
+    // the next carrier's grants for that UE ahead of its own share.
+    int bits = 0, rb_used = 0;
+    *comps_used = 0;
+    for (int k = 0; k < cs->n; ++k) {
+        Carrier *c = &cs->cc[k];
+        // serve_hol takes the TX channel from the UE
+        for (int g = 0; g < c->n_grants; ++g) carrier_set_channel(c, &ues[c->grants[g].ue_id]);
+        int rb = 0, used = 0;
+        int b = schedule_grants(ues, cs->num_ues, c->grants, c->n_grants, c->rb, &rb,
+                                comps + *comps_used, comps_cap - *comps_used, &used);
+        *comps_used += used;
+        c->rb_left = c->rb - rb;
+        bits    += b;
+        rb_used += rb;
+        m->ca_rb_used[k]   += rb;
+        m->ca_bits_sent[k] += b;
+    }
+
+    // Step 5: grants left unused (the UE emptied early through rounding on
+    // earlier carriers) are handed to plain EDF over what is still queued
+    for (int k = 0; k < cs->n; ++k) {
+        Carrier *c = &cs->cc[k];
+        if (c->rb_left <= 0) continue;
+        int n_left = 0;
+        for (int i = 0; i < cs->n_act; ++i) {
+            UE *u = &ues[cs->act[i]];
+            if (u->q_count == 0) continue;
+            carrier_set_channel(c, u);
+            n_left++;
+        }
+        if (n_left == 0) break;
+        int rb = 0, used = 0;
+        int b = schedule_edf(ues, cs->num_ues, c->rb_left, 0, m, &rb,
+                             comps + *comps_used, comps_cap - *comps_used, &used);
+        *comps_used += used;
+        bits    += b;
+        rb_used += rb;
+        m->ca_rb_used[k]   += rb;
+        m->ca_bits_sent[k] += b;
+    }
+
+    // The grant phases left each UE on whichever carrier served it last;
+    // allocation records and per-UE stats report the primary cell
+    for (int u = 0; u < cs->num_ues; ++u) carrier_set_channel(&cs->cc[0], &ues[u]);
+
+    if (rb_used_out) *rb_used_out = rb_used;
+    return bits;
+}
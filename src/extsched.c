@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L
+#include "extsched.h"
+#include "metrics.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define EXT_ATTACH_WAIT_MS 10000   // first TTI waits for the client to attach
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void ext_backoff(unsigned *spins) {
+    if (++*spins < 256) return;
+    sched_yield();
+}
+
+int ext_sched_open(ExtSched *x, const char *name, int num_ues, int rb_total, int timeout_ms) {
+    memset(x, 0, sizeof(*x));
+    snprintf(x->name, sizeof(x->name), "%s%s", name[0] == '/' ? "" : "/", name);
+    x->timeout_ms = timeout_ms > 0 ? timeout_ms : 1000;
+    x->size = ext_shm_bytes(num_ues, rb_total);
+
+    shm_unlink(x->name);   // stale segment from a crashed run
+    int fd = shm_open(x->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "[error] shm_open %s: %s\n", x->name, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)x->size) != 0) {
+        fprintf(stderr, "[error] ftruncate %s: %s\n", x->name, strerror(errno));
+        close(fd);
+        shm_unlink(x->name);
+        return -1;
+    }
+    void *mem = mmap(NULL, x->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "[error] mmap %s: %s\n", x->name, strerror(errno));
+        shm_unlink(x->name);
+        return -1;
+    }
+
+    ExtShm *h = (ExtShm*)mem;   // ftruncate zero-filled the segment
+    h->version    = EXT_VERSION;
+    h->num_ues    = num_ues;
+    h->rb_total   = rb_total;
+    h->pkt_cap    = ext_pkt_cap(rb_total);
+    h->grant_cap  = ext_grant_cap(num_ues, rb_total);
+    h->req_bytes  = (uint32_t)ext_req_bytes(num_ues, rb_total);
+    h->resp_bytes = (uint32_t)ext_resp_bytes(num_ues, rb_total);
+    atomic_thread_fence(memory_order_release);
+    h->magic = EXT_MAGIC;   // published last: clients poll for it
+    x->shm = h;
+    return 0;
+}
+
+void ext_sched_close(ExtSched *x) {
+    if (!x || !x->shm) return;
+    atomic_store_explicit(&x->shm->shutdown, 1, memory_order_release);
+    munmap(x->shm, x->size);
+    shm_unlink(x->name);
+    x->shm = NULL;
+}
+
+int ext_sched_exchange(ExtSched *x, const UE *ues, int num_ues, int tti, int rb_budget,
+                       const Grant **grants, int *num_grants) {
+    ExtShm *h = x->shm;
+    if (x->no_client) {
+        x->timeouts++;
+        return -1;
+    }
+    uint64_t seq = atomic_load_explicit(&h->req_tail, memory_order_relaxed);
+    if (seq - atomic_load_explicit(&h->req_head, memory_order_acquire) >= EXT_RING) {
+        x->timeouts++;   // client is behind by a full ring: don't overwrite
+        return -1;
+    }
+
+    long long t0 = now_ns();
+    ExtReq *req = ext_req_slot(h, seq);
+    req->tti = tti;
+    req->rb_budget = rb_budget;
+    req->num_ues = num_ues;
+    ExtUEState *st = ext_req_ues(req);
+    const int pkt_cap = h->pkt_cap;
+    for (int i = 0; i < num_ues; ++i) {
+        const UE *u = &ues[i];
+        ExtUEState *e = &st[i];
+        ExtPkt *pk = ext_req_pkts(req) + (size_t)i * pkt_cap;
+        long long q_bits = 0;
+        for (int k = 0, idx = u->q_head; k < u->q_count; ++k, idx = (idx + 1) % MAX_QUEUE) {
+            q_bits += u->q[idx].bits;
+            if (k < pkt_cap) pk[k] = (ExtPkt){ .deadline = u->q[idx].deadline_us, .bits = u->q[idx].bits };
+        }
+        e->n_pkts        = u->q_count < pkt_cap ? u->q_count : pkt_cap;
+        e->q_pkts        = u->q_count;
+        e->q_bits        = (int32_t)(q_bits < INT32_MAX ? q_bits : INT32_MAX);
+        e->hol_bits      = u->q_count ? u->q[u->q_head].bits : 0;
+        e->hol_deadline  = u->q_count ? u->q[u->q_head].deadline_us : 0;
+        e->tail_deadline = u->q_count ? u->q[(u->q_tail - 1 + MAX_QUEUE) % MAX_QUEUE].deadline_us : 0;
+        e->bprb          = u->bprb_cur > 0 ? u->bprb_cur : bits_per_rb_for_cqi(u->cqi);
+        e->cqi           = u->cqi;
+        e->rb_err_prob   = (float)u->rb_err_prob_cur;
+    }
+    atomic_store_explicit(&h->req_tail, seq + 1, memory_order_release);
+
+    // Wait for the matching response, discarding late ones for earlier TTIs
+    int wait_ms = atomic_load_explicit(&h->attached, memory_order_acquire)
+                ? x->timeout_ms : EXT_ATTACH_WAIT_MS;
+    long long deadline = t0 + (long long)wait_ms * 1000000LL;
+    unsigned spins = 0;
+    ExtResp *resp = NULL;
+    while (!resp) {
+        uint64_t rseq = atomic_load_explicit(&h->resp_head, memory_order_relaxed);
+        if (atomic_load_explicit(&h->resp_tail, memory_order_acquire) != rseq) {
+            ExtResp *r = ext_resp_slot(h, rseq);
+            if (r->tti == tti) resp = r;
+            // the slot is only reused after EXT_RING more requests, so
+            // releasing it before we read the grants is safe in lockstep
+            atomic_store_explicit(&h->resp_head, rseq + 1, memory_order_release);
+            continue;
+        }
+        ext_backoff(&spins);
+        if ((spins & 63) == 0 && now_ns() > deadline) {
+            if (!atomic_load_explicit(&h->attached, memory_order_acquire)) {
+                fprintf(stderr, "[warn] no client attached to %s, using built-in EDF\n", x->name);
+                x->no_client = true;
+            }
+            x->timeouts++;
+            return -1;
+        }
+    }
+    lathist_add(&x->rtt_ns, now_ns() - t0);
+
+    *grants = ext_resp_grants(resp);
+    *num_grants = resp->num_grants < h->grant_cap ? resp->num_grants : h->grant_cap;
+    return 0;
+}
+
+ExtShm *ext_client_attach(const char *name, int wait_ms, size_t *size_out) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s%s", name[0] == '/' ? "" : "/", name);
+    long long deadline = now_ns() + (long long)wait_ms * 1000000LL;
+
+    for (;;) {
+        int fd = shm_open(path, O_RDWR, 0);
+        if (fd >= 0) {
+            ExtShm hdr;
+            ssize_t got = pread(fd, &hdr, sizeof(hdr), 0);
+            if (got == (ssize_t)sizeof(hdr) && hdr.magic == EXT_MAGIC) {
+                if (hdr.version != EXT_VERSION) {
+                    fprintf(stderr, "[error] %s: version %u, expected %u\n", path, hdr.version, EXT_VERSION);
+                    close(fd);
+                    return NULL;
+                }
+                size_t size = ext_shm_bytes(hdr.num_ues, hdr.rb_total);
+                void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (mem == MAP_FAILED) return NULL;
+                ExtShm *h = (ExtShm*)mem;
+                atomic_store_explicit(&h->attached, 1, memory_order_release);
+                if (size_out) *size_out = size;
+                return h;
+            }
+            close(fd);   // segment exists but is not initialised yet
+        }
+        if (now_ns() > deadline) return NULL;
+        struct timespec ts = { 0, 10 * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
@@ -0,0 +1,105 @@
+// Reference external scheduler: attaches to the simulator's shared-memory
+// rings and answers every TTI with grants from the built-in EDF.
+//
+// Each UE is rebuilt as a proxy queue from the published packet list,
+// which holds every packet EDF could reach this TTI. The grants follow
+// EDF's allocation order, so the simulator's schedule is identical to a
+// run without --ext-sched.
+#define _POSIX_C_SOURCE 200809L
+#include "common.h"
+#include "extsched.h"
+#include "scheduler.h"
+#include <sys/mman.h>
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+        "Usage: %s --shm NAME [--wait-ms N]\n"
+        "  --shm NAME     shared-memory segment given to l1sched --ext-sched\n"
+        "  --wait-ms N    how long to wait for the simulator (default 10000)\n",
+        argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *name = NULL;
+    int wait_ms = 10000;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--shm") && i+1 < argc) name = argv[++i];
+        else if (!strcmp(argv[i], "--wait-ms") && i+1 < argc) wait_ms = atoi(argv[++i]);
+        else { usage(argv[0]); return 1; }
+    }
+    if (!name) { usage(argv[0]); return 1; }
+
+    size_t size = 0;
+    ExtShm *h = ext_client_attach(name, wait_ms, &size);
+    if (!h) {
+        fprintf(stderr, "[error] could not attach to %s\n", name);
+        return 1;
+    }
+
+    int n = h->num_ues;
+    int pkt_cap = h->pkt_cap;
+    UE *proxy = (UE*)calloc(n, sizeof(UE));
+    Packet *pk = (Packet*)calloc((size_t)n * pkt_cap, sizeof(Packet));
+    Completion *comps = (Completion*)calloc(h->rb_total, sizeof(Completion));
+    Grant *order = (Grant*)calloc(h->grant_cap, sizeof(Grant));
+    long long ttis = 0;
+
+    unsigned spins = 0;
+    while (!atomic_load_explicit(&h->shutdown, memory_order_acquire)) {
+        uint64_t seq = atomic_load_explicit(&h->req_head, memory_order_relaxed);
+        if (atomic_load_explicit(&h->req_tail, memory_order_acquire) == seq) {
+            ext_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+
+        ExtReq *req = ext_req_slot(h, seq);
+        const ExtUEState *st = ext_req_ues(req);
+        const ExtPkt *rp = ext_req_pkts(req);
+        for (int i = 0; i < n; ++i) {
+            UE *u = &proxy[i];
+            // q_head never wraps: one TTI pops at most pkt_cap packets
+            u->q = &pk[(size_t)i * pkt_cap];
+            u->id = i;
+            u->q_head = 0;
+            u->q_count = 0;
+            u->cqi = st[i].cqi;
+            u->bprb_cur = st[i].bprb;
+            u->rb_err_prob_cur = st[i].rb_err_prob;
+            u->dbg_tx_bits_this_tti = 0;
+            u->dbg_was_scheduled = 0;
+            const ExtPkt *p = &rp[(size_t)i * pkt_cap];
+            for (int k = 0; k < st[i].n_pkts; ++k)
+                u->q[k] = (Packet){ .bits = p[k].bits, .deadline_us = p[k].deadline };
+            u->q_count = st[i].n_pkts;
+        }
+
+        int rb_used = 0, comps_used = 0, n_order = 0;
+        schedule_edf_order(proxy, n, req->rb_budget, 0, &rb_used,
+                           comps, h->rb_total, &comps_used, order, &n_order);
+
+        // Wait for response space; the simulator may exit with the ring full
+        uint64_t rseq = atomic_load_explicit(&h->resp_tail, memory_order_relaxed);
+        while (rseq - atomic_load_explicit(&h->resp_head, memory_order_acquire) >= EXT_RING) {
+            if (atomic_load_explicit(&h->shutdown, memory_order_acquire)) break;
+            ext_backoff(&spins);
+        }
+        if (rseq - atomic_load_explicit(&h->resp_head, memory_order_acquire) >= EXT_RING) break;
+        ExtResp *resp = ext_resp_slot(h, rseq);
+        memcpy(ext_resp_grants(resp), order, (size_t)n_order * sizeof(Grant));
+        resp->tti = req->tti;
+        resp->num_grants = n_order;
+
+        atomic_store_explicit(&h->req_head, seq + 1, memory_order_release);
+        atomic_store_explicit(&h->resp_tail, rseq + 1, memory_order_release);
+        ttis++;
+    }
+
+    fprintf(stderr, "[client] served %lld TTIs\n", ttis);
+    free(order);
+    free(comps);
+    free(pk);
+    free(proxy);
+    munmap(h, size);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "l1sched.h"
+#include "sim.h"
+#include "metrics.h"
+
+_Static_assert(L1S_MAX_CARRIERS == MAX_CARRIERS, "carrier arrays differ");
+_Static_assert(L1S_LOG_SCHED == LOG_SCHED && L1S_LOG_EVENTS == LOG_EVENTS &&
+               L1S_LOG_CHANNEL == LOG_CHANNEL, "log stream bits differ");
+_Static_assert((int)L1S_ACK == (int)EV_ACK && (int)L1S_NACK == (int)EV_NACK &&
+               (int)L1S_DROP == (int)EV_DROP,
+               "HARQ event kinds differ");
+
+// The Sim's record buffers are handed out as the public types
+#define L1S_SAME_FIELD(pub, pf, in, f) \
+    _Static_assert(offsetof(pub, pf) == offsetof(in, f) && \
+                   sizeof(((pub*)0)->pf) == sizeof(((in*)0)->f), #pub "." #pf " layout differs");
+L1S_SAME_FIELD(L1sAlloc, tti, AllocRecord, tti)
+L1S_SAME_FIELD(L1sAlloc, ue_id, AllocRecord, ue_id)
+L1S_SAME_FIELD(L1sAlloc, bits, AllocRecord, bits)
+L1S_SAME_FIELD(L1sAlloc, rb, AllocRecord, rb)
+L1S_SAME_FIELD(L1sAlloc, cqi, AllocRecord, cqi)
+L1S_SAME_FIELD(L1sAlloc, queue_after, AllocRecord, queue_after)
+L1S_SAME_FIELD(L1sAlloc, hol_deadline_us, AllocRecord, hol_deadline)
+_Static_assert(sizeof(L1sAlloc) == sizeof(AllocRecord), "L1sAlloc size differs");
+L1S_SAME_FIELD(L1sHarq, tti, HarqRecord, tti)
+L1S_SAME_FIELD(L1sHarq, ue_id, HarqRecord, ue_id)
+L1S_SAME_FIELD(L1sHarq, kind, HarqRecord, kind)
+L1S_SAME_FIELD(L1sHarq, pkt_bits, HarqRecord, pkt_bits)
+L1S_SAME_FIELD(L1sHarq, retx, HarqRecord, retx)
+L1S_SAME_FIELD(L1sHarq, cqi, HarqRecord, cqi)
+L1S_SAME_FIELD(L1sHarq, rb_alloc, HarqRecord, rb_alloc)
+L1S_SAME_FIELD(L1sHarq, sinr_db, HarqRecord, sinr_db)
+L1S_SAME_FIELD(L1sHarq, rb_perr, HarqRecord, rb_perr)
+_Static_assert(sizeof(L1sHarq) == sizeof(HarqRecord), "L1sHarq size differs");
+#undef L1S_SAME_FIELD
+
+// Scalar fields with the same name and meaning in L1sConfig and Config
+#define L1S_CONFIG_FIELDS(X) \
+    X(ttis) X(rb_total) X(num_ues) X(seed) X(arrival_rate) \
+    X(pkt_bits_min) X(pkt_bits_max) X(deadline_us) X(bler) X(harq_rtt_us) \
+    X(out_dir) X(csv_path) X(log_streams) X(log_ues) X(log_every) X(log_sample) \
+    X(slot_us) X(minislot_syms) X(urllc_rate) X(urllc_bits) X(urllc_deadline_us) X(preempt) \
+    X(ext_shm) X(ext_timeout_ms) \
+    X(phy_mode) X(pathloss_exp) X(shadowing_std_db) X(fading_rho) X(snr_ref_db) \
+    X(rb_floor_perr) X(phy_pipeline) X(phy_lazy) \
+    X(mu_mimo) X(mu_corr_th) X(mu_cand_max) \
+    X(perf_counters) X(n_carriers)
+
+#define L1S_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+struct L1Sched {
+    Sim sim;
+};
+
+int l1s_api_version(void) { return L1SCHED_API_VERSION; }
+
+void l1s_config_init(L1sConfig *cfg, size_t size) {
+    if (!cfg || size < sizeof(size_t)) return;
+    Config c;
+    sim_config_defaults(&c);
+
+    L1sConfig full;
+    memset(&full, 0, sizeof(full));
+#define L1S_EXPORT(f) full.f = c.f;
+    L1S_CONFIG_FIELDS(L1S_EXPORT)
+#undef L1S_EXPORT
+    memcpy(full.carrier_rb, c.carrier_rb, sizeof(full.carrier_rb));
+    memcpy(full.carrier_snr_off_db, c.carrier_snr_off_db, sizeof(full.carrier_snr_off_db));
+
+    // an older caller only has the first size bytes
+    memcpy(cfg, &full, L1S_MIN(size, sizeof(full)));
+    cfg->size = size;
+}
+
+L1Sched *l1s_create(const L1sConfig *cfg) {
+    if (!cfg || cfg->size < sizeof(size_t)) return NULL;
+
+    // Defaults for the fields this caller was not built with
+    L1sConfig in;
+    l1s_config_init(&in, sizeof(in));
+    memcpy(&in, cfg, L1S_MIN(cfg->size, sizeof(in)));
+
+    Config c;
+    sim_config_defaults(&c);
+#define L1S_IMPORT(f) c.f = in.f;
+    L1S_CONFIG_FIELDS(L1S_IMPORT)
+#undef L1S_IMPORT
+    memcpy(c.carrier_rb, in.carrier_rb, sizeof(c.carrier_rb));
+    memcpy(c.carrier_snr_off_db, in.carrier_snr_off_db, sizeof(c.carrier_snr_off_db));
+
+    // same range and combination rules as the CLI
+    if (sim_config_check(&c) != CFG_OK) return NULL;
+
+    L1Sched *h = (L1Sched*)calloc(1, sizeof(L1Sched));
+    if (!h) return NULL;
+    sim_init(&h->sim, &c);
+    return h;
+}
+
+void l1s_destroy(L1Sched *h) {
+    if (!h) return;
+    sim_free(&h->sim);
+    free(h);
+}
+
+int l1s_step(L1Sched *h) {
+    Sim *s = &h->sim;
+    if (s->tti >= s->cfg.ttis) return -1;
+    sim_step(s);
+    return s->tti++;
+}
+
+void l1s_run(L1Sched *h) { sim_run(&h->sim); }
+
+int l1s_tti(const L1Sched *h) { return h->sim.tti; }
+
+const L1sAlloc *l1s_allocs(const L1Sched *h, int *count) {
+    if (count) *count = h->sim.n_allocs;
+    return (const L1sAlloc*)h->sim.allocs;
+}
+
+const L1sHarq *l1s_harq(const L1Sched *h, int *count) {
+    if (count) *count = h->sim.n_fb;
+    return (const L1sHarq*)h->sim.fb;
+}
+
+int l1s_stats(const L1Sched *h, L1sStats *out) {
+    if (!out || out->size < sizeof(size_t)) return -1;
+    const Metrics *m = &h->sim.m;
+
+    L1sStats st = {
+        .size = out->size,
+        .ttis_done = h->sim.tti,
+        .packets = m->total_packets,
+        .deadline_misses = m->deadline_misses,
+        .bits_sent = m->total_bits_sent,
+        .rb_used = m->rb_used_total,
+        .mu_pairs = m->mu_pairs,
+        .preempted = m->preempted,
+        .embb_packets = m->cls_packets[PKT_EMBB],
+        .embb_misses = m->cls_misses[PKT_EMBB],
+        .urllc_packets = m->cls_packets[PKT_URLLC],
+        .urllc_misses = m->cls_misses[PKT_URLLC],
+        .lat_p50_us = metrics_lat_us(m, &m->lat, 0.50),
+        .lat_p99_us = metrics_lat_us(m, &m->lat, 0.99),
+        .lat_p999_us = metrics_lat_us(m, &m->lat, 0.999),
+        .lat_max_us = m->lat.max * m->lat_unit_us
+    };
+    memcpy(out, &st, L1S_MIN(out->size, sizeof(st)));
+    return 0;
+}
+
+int l1s_num_ues(const L1Sched *h) { return h->sim.cfg.num_ues; }
+
+int l1s_ue_stats(const L1Sched *h, int ue, L1sUEStats *out) {
+    if (!out || out->size < sizeof(size_t)) return -1;
+    if (ue < 0 || ue >= h->sim.cfg.num_ues) return -1;
+    const UE *u = &h->sim.ues[ue];
+    const Metrics *m = &h->sim.m;
+
+    L1sUEStats st = {
+        .size = out->size,
+        .bits_sent = u->bits_sent_total,
+        .bits_delivered = u->bits_delivered,
+        .pkts_delivered = u->pkts_delivered,
+        .pkts_missed = u->pkts_missed,
+        .queue_pkts = u->q_count,
+        .cqi = u->cqi,
+        .sinr_db = u->sinr_db_cur,
+        .lat_p50_us = metrics_lat_us(m, &m->ue_lat[ue], 0.50),
+        .lat_p99_us = metrics_lat_us(m, &m->ue_lat[ue], 0.99)
+    };
+    memcpy(out, &st, L1S_MIN(out->size, sizeof(st)));
+    return 0;
+}
+
+void l1s_print_summary(const L1Sched *h) { sim_print_summary(&h->sim); }
+
+int l1s_write_summary(const L1Sched *h, const char *path) {
+    return sim_write_summary(&h->sim, path);
+}
@@ -1,26 +1,61 @@
 #include "common.h"
 #include "sim.h"
+#include "trace.h"
+#include "carrier.h"
 
 static void usage(const char *argv0) {
     fprintf(stderr,
         "Usage: %s --ttis N --rb N --ues N [options]\n"
         "\n"
         "Required:\n"
-        "  --ttis N           total TTIs to simulate (e.g., 10000)\n"
-        "  --rb N             resource blocks per TTI (capacity)\n"
+        "  --ttis N           total TTIs (slots) to simulate (e.g., 10000)\n"
+        "  --rb N             resource blocks per slot (capacity; optional with --carriers)\n"
         "  --ues N            number of UEs\n"
         "\n"
         "Traffic / deadlines:\n"
-        "  --arrival P        arrival prob per UE per TTI (default 0.2)\n"
-        "  --deadline D       relative deadline in TTIs (default 8)\n"
+        "  --arrival P        eMBB arrival prob per UE per ms (default 0.2)\n"
+        "  --deadline D       relative eMBB deadline in ms (default 8)\n"
+        "  --deadline-us N    same, in microseconds\n"
         "  --seed S           RNG seed (default 42)\n"
         "\n"
         "HARQ (legacy BLER path):\n"
         "  --bler P           BLER (0..1) for HARQ (default 0.1)\n"
-        "  --harq N           HARQ RTT in TTIs (default 8)\n"
+        "  --harq N           HARQ RTT in ms (default 8)\n"
+        "  --harq-us N        same, in microseconds\n"
+        "\n"
+        "Numerology / URLLC:\n"
+        "  --slot-us N        slot duration in us (default 1000; 500/250/125 for\n"
+        "                     NR numerology 1/2/3; --rb stays per slot)\n"
+        "  --numerology MU    shorthand for --slot-us (1000 >> MU)\n"
+        "  --minislot S       URLLC mini-slots of S symbols (2, 4 or 7) inside each slot\n"
+        "  --urllc-rate P     URLLC arrival prob per UE per ms (default 0 = none)\n"
+        "  --urllc-bits N     URLLC packet size (default 256)\n"
+        "  --urllc-deadline-us N  URLLC relative deadline (default 1000)\n"
+        "  --preempt          mini-slots may puncture this slot's eMBB TBs (NACKed)\n"
         "\n"
         "Output:\n"
         "  --csv PATH         write per-TTI allocations to CSV file\n"
+        "  --log LIST         enable log streams: sched,events,channel | all | none\n"
+        "                     (default none; written to --out-dir)\n"
+        "  --out-dir DIR      directory for log streams (default data)\n"
+        "  --log-ues LIST     only log these UEs, e.g. 0-7,12 (default all)\n"
+        "  --log-every N      log sched/channel snapshots every Nth TTI (default 1)\n"
+        "  --log-sample K     keep a uniform reservoir sample of K HARQ events\n"
+        "  --summary PATH     write JSON summary (latency percentiles, per-UE\n"
+        "                     throughput/miss rate, fairness, time series)\n"
+        "\n"
+        "External scheduler:\n"
+        "  --ext-sched NAME   publish UE state to POSIX shm NAME each TTI and apply\n"
+        "                     grants from an external process (see l1sched_edf_client)\n"
+        "  --ext-timeout-ms N per-TTI wait for grants before falling back to EDF\n"
+        "                     (default 1000)\n"
+        "\n"
+        "Performance:\n"
+        "  --no-specialize    use the generic sim_step instead of the variant\n"
+        "                     specialised for this PHY mode / URLLC / log set (benchmarking)\n"
+        "  --perf-counters    per-stage cost of sim_step (HARQ, PHY, arrivals, expiry,\n"
+        "                     schedule, logging): time, IPC and cache/branch misses\n"
+        "                     per UE per TTI via perf_event_open (clock only if refused)\n"
         "\n"
         "PHY / channel model (set --phy-mode 1 to enable):\n"
         "  --phy-mode M       0=legacy (default), 1=channel-based with RB errors\n"
@@ -29,6 +64,23 @@ static void usage(const char *argv0) {
         "  --fading-rho X     AR(1) fast-fading correlation 0..1 (default 0.9)\n"
         "  --snr-ref X        reference (median) SNR in dB (default 18.0)\n"
         "  --rb-floor-perr X  minimum per-RB error probability (default 1e-4)\n"
+        "  --phy-pipeline     experimental: precompute the next TTI's channel on a\n"
+        "                     helper thread while the current TTI is scheduled\n"
+        "                     (same results, no speedup measured yet)\n"
+        "  --phy-lazy         only evaluate the channel of UEs with queued data,\n"
+        "                     catching idle UEs up in one AR(1) draw (same\n"
+        "                     distribution, cost scales with active UEs)\n"
+        "\n"
+        "MU-MIMO (needs --phy-mode 1):\n"
+        "  --mu-mimo          co-schedule spatially compatible UEs on the same RBs\n"
+        "  --mu-corr-th X     max channel correlation |h_i^H h_j| of a pair (default 0.2)\n"
+        "  --mu-cand-max K    partner search over the K earliest-deadline UEs (default 64)\n"
+        "\n"
+        "Carrier aggregation (needs --phy-mode 1):\n"
+        "  --carriers LIST    component carriers as RB[:SNR offset dB],... e.g.\n"
+        "                     100:0,50:-3,25:-6 (up to 8); each has its own channel\n"
+        "                     and runs PHY + EDF on its own thread, UE queues are\n"
+        "                     shared and split across carriers; --rb is the sum\n"
         "\n"
         "Notes:\n"
         "  * When --phy-mode 1 is used, HARQ ACK/NACK is driven by RB-level errors.\n"
@@ -37,39 +89,47 @@ static void usage(const char *argv0) {
 }
 
 int main(int argc, char **argv) {
-    Config cfg = {
-        .ttis = -1,
-        .rb_total = -1,
-        .num_ues = -1,
-        .seed = 42,
-        .arrival_rate = 0.2,
-        .pkt_bits_min = 800,    // ~100 bytes
-        .pkt_bits_max = 12000,  // ~1500 bytes
-        .deadline_ttis = 8,
-        .bler = 0.1,
-        .harq_rtt = 8,
-        .out_dir = NULL,
-        .csv_path = NULL,
-        
-        // PHY Defaults
-        .phy_mode = 0, 
-        .pathloss_exp = 3.5,
-        .shadowing_std_db = 6.0,
-        .fading_rho = 0.9,
-        .snr_ref_db = 18.0,
-        .rb_floor_perr = 1e-4
-    };
+    Config cfg;
+    sim_config_defaults(&cfg);
 
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "--ttis") && i+1 < argc) cfg.ttis = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--rb") && i+1 < argc) cfg.rb_total = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--ues") && i+1 < argc) cfg.num_ues = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--arrival") && i+1 < argc) cfg.arrival_rate = atof(argv[++i]);
-        else if (!strcmp(argv[i], "--deadline") && i+1 < argc) cfg.deadline_ttis = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--deadline") && i+1 < argc) cfg.deadline_us = atoi(argv[++i]) * 1000;
+        else if (!strcmp(argv[i], "--deadline-us") && i+1 < argc) cfg.deadline_us = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--seed") && i+1 < argc) cfg.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
         else if (!strcmp(argv[i], "--bler") && i+1 < argc) cfg.bler = atof(argv[++i]);
-        else if (!strcmp(argv[i], "--harq") && i+1 < argc) cfg.harq_rtt = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--harq") && i+1 < argc) cfg.harq_rtt_us = atoi(argv[++i]) * 1000;
+        else if (!strcmp(argv[i], "--harq-us") && i+1 < argc) cfg.harq_rtt_us = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--csv") && i+1 < argc) cfg.csv_path = argv[++i];
+        else if (!strcmp(argv[i], "--summary") && i+1 < argc) cfg.summary_path = argv[++i];
+        else if (!strcmp(argv[i], "--log") && i+1 < argc) {
+            cfg.log_streams = trace_parse_streams(argv[++i]);
+            if (cfg.log_streams < 0) { usage(argv[0]); return 1; }
+        }
+        else if (!strcmp(argv[i], "--out-dir") && i+1 < argc) cfg.out_dir = argv[++i];
+        else if (!strcmp(argv[i], "--log-ues") && i+1 < argc) cfg.log_ues = argv[++i];
+        else if (!strcmp(argv[i], "--log-every") && i+1 < argc) cfg.log_every = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--log-sample") && i+1 < argc) cfg.log_sample = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--ext-sched") && i+1 < argc) cfg.ext_shm = argv[++i];
+        else if (!strcmp(argv[i], "--ext-timeout-ms") && i+1 < argc) cfg.ext_timeout_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-specialize")) cfg.step_generic = 1;
+        else if (!strcmp(argv[i], "--perf-counters")) cfg.perf_counters = 1;
+
+        // Numerology / URLLC args
+        else if (!strcmp(argv[i], "--slot-us") && i+1 < argc) cfg.slot_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--numerology") && i+1 < argc) {
+            int mu = atoi(argv[++i]);
+            if (mu < 0 || mu > 3) { usage(argv[0]); return 1; }
+            cfg.slot_us = 1000 >> mu;
+        }
+        else if (!strcmp(argv[i], "--minislot") && i+1 < argc) cfg.minislot_syms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--urllc-rate") && i+1 < argc) cfg.urllc_rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--urllc-bits") && i+1 < argc) cfg.urllc_bits = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--urllc-deadline-us") && i+1 < argc) cfg.urllc_deadline_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--preempt")) cfg.preempt = 1;
 
         // PHY / channel args
         else if (!strcmp(argv[i], "--phy-mode") && i+1 < argc) cfg.phy_mode = atoi(argv[++i]);
@@ -78,22 +138,36 @@ int main(int argc, char **argv) {
         else if (!strcmp(argv[i], "--fading-rho") && i+1 < argc) cfg.fading_rho = atof(argv[++i]);
         else if (!strcmp(argv[i], "--snr-ref") && i+1 < argc) cfg.snr_ref_db = atof(argv[++i]);
         else if (!strcmp(argv[i], "--rb-floor-perr") && i+1 < argc) cfg.rb_floor_perr = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--phy-pipeline")) cfg.phy_pipeline = 1;
+        else if (!strcmp(argv[i], "--phy-lazy")) cfg.phy_lazy = 1;
+
+        // MU-MIMO args
+        else if (!strcmp(argv[i], "--mu-mimo")) cfg.mu_mimo = 1;
+        else if (!strcmp(argv[i], "--mu-corr-th") && i+1 < argc) cfg.mu_corr_th = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--mu-cand-max") && i+1 < argc) cfg.mu_cand_max = atoi(argv[++i]);
+
+        // Carrier aggregation args
+        else if (!strcmp(argv[i], "--carriers") && i+1 < argc) {
+            if (carrier_parse_spec(argv[++i], &cfg) != 0) {
+                fprintf(stderr, "[error] bad --carriers list: %s\n", argv[i]);
+                return 1;
+            }
+        }
         else {
             usage(argv[0]);
             return 1;
         }
     }
 
-    if (cfg.ttis <= 0 || cfg.rb_total <= 0 || cfg.num_ues <= 0) {
+    int err = sim_config_check(&cfg);
+    if (err == CFG_ERR_SIZE || err == CFG_ERR_TIME) {
         usage(argv[0]);
         return 1;
     }
-
-    // Clamp some PHY params to sane ranges
-    if (cfg.fading_rho < 0.0) cfg.fading_rho = 0.0;
-    if (cfg.fading_rho > 0.999) cfg.fading_rho = 0.999;
-    if (cfg.rb_floor_perr < 0.0) cfg.rb_floor_perr = 0.0;
-    if (cfg.rb_floor_perr > 1.0) cfg.rb_floor_perr = 1.0;
+    if (err != CFG_OK) {
+        fprintf(stderr, "[error] %s\n", sim_config_error(err));
+        return 1;
+    }
 
     rng_seed(cfg.seed);
 
@@ -105,6 +179,7 @@ int main(int argc, char **argv) {
     sim_init(&sim, &cfg);
     sim_run(&sim);
     sim_print_summary(&sim);
+    if (cfg.summary_path) sim_write_summary(&sim, cfg.summary_path);
     sim_free(&sim);
     return 0;
 }
@@ -1,14 +1,189 @@
 #include "metrics.h"
 
-void metrics_on_deliver(Metrics *m, const Packet *p, int now_tti, int bits_just_sent) {
+void metrics_init(Metrics *m, int num_ues, int lat_unit_us) {
+    memset(m, 0, sizeof(*m));
+    m->num_ues = num_ues;
+    m->lat_unit_us = lat_unit_us > 0 ? lat_unit_us : 1;
+    m->ue_lat = (LatHist*)calloc(num_ues, sizeof(LatHist));
+    m->ts.win = 1;
+}
+
+void metrics_free(Metrics *m) {
+    if (!m) return;
+    free(m->ue_lat);
+    m->ue_lat = NULL;
+    m->num_ues = 0;
+}
+
+// ----------------- Latency histogram -----------------
+
+static int lathist_index(long long v) {
+    if (v < 0) v = 0;
+    int msb = 63 - __builtin_clzll((unsigned long long)v | 1ULL);
+    int shift = msb - LAT_SUB_BITS;
+    if (shift < 0) shift = 0;
+    int idx = shift * LAT_SUB + (int)(v >> shift);
+    return idx < LAT_BUCKETS ? idx : LAT_BUCKETS - 1;
+}
+
+// Highest value that maps to bucket idx (HDR "highest equivalent value")
+static long long lathist_bucket_hi(int idx) {
+    int shift = idx / LAT_SUB - 1;
+    if (shift < 0) shift = 0;
+    long long mant = idx - (long long)shift * LAT_SUB;
+    return ((mant + 1) << shift) - 1;
+}
+
+void lathist_add(LatHist *h, long long v) {
+    h->b[lathist_index(v)]++;
+    h->count++;
+    if (v > h->max) h->max = v;
+}
+
+long long lathist_quantile(const LatHist *h, double q) {
+    if (h->count == 0) return 0;
+    long long rank = (long long)ceil(q * (double)h->count);
+    if (rank < 1) rank = 1;
+    long long cum = 0;
+    for (int i = 0; i < LAT_BUCKETS; ++i) {
+        cum += h->b[i];
+        if (cum >= rank) {
+            long long hi = lathist_bucket_hi(i);
+            return hi < h->max ? hi : h->max;
+        }
+    }
+    return h->max;
+}
+
+long long metrics_lat_us(const Metrics *m, const LatHist *h, double q) {
+    return lathist_quantile(h, q) * m->lat_unit_us;
+}
+
+// ----------------- Event hooks -----------------
+
+void metrics_on_deliver(Metrics *m, int ue_id, const Packet *p, long long now_us, int bits_just_sent) {
     (void)bits_just_sent;
-    int latency = now_tti - p->arrival_tti;
+    long long latency = now_us - p->arrival_us;
     if (latency < 0) latency = 0;
     m->sum_latency += latency;
+    long long units = latency / m->lat_unit_us;
+    lathist_add(&m->lat, units);
+    if (p->cls >= 0 && p->cls < PKT_CLASSES) lathist_add(&m->cls_lat[p->cls], units);
+    if (ue_id >= 0 && ue_id < m->num_ues) lathist_add(&m->ue_lat[ue_id], units);
     // delivered packets are accounted implicitly as total_packets - deadline_misses
 }
 
 void metrics_on_miss(Metrics *m, const Packet *p) {
-    (void)p;
     m->deadline_misses++;
+    if (p->cls >= 0 && p->cls < PKT_CLASSES) m->cls_misses[p->cls]++;
+}
+
+void metrics_on_tti(Metrics *m, int rb_used, long long queued_pkts) {
+    TimeSeries *ts = &m->ts;
+    ts->rb[ts->n] += rb_used;
+    ts->q[ts->n]  += queued_pkts;
+    if (++ts->fill < ts->win) return;
+
+    ts->fill = 0;
+    if (++ts->n < TS_SLOTS) {
+        ts->rb[ts->n] = ts->q[ts->n] = 0;
+        return;
+    }
+    // All slots full: halve resolution so memory stays fixed
+    for (int i = 0; i < TS_SLOTS / 2; ++i) {
+        ts->rb[i] = ts->rb[2*i] + ts->rb[2*i + 1];
+        ts->q[i]  = ts->q[2*i]  + ts->q[2*i + 1];
+    }
+    ts->n = TS_SLOTS / 2;
+    ts->win *= 2;
+    ts->rb[ts->n] = ts->q[ts->n] = 0;
+}
+
+double metrics_jain_index(const UE *ues, int num_ues) {
+    double sum = 0.0, sum2 = 0.0;
+    for (int i = 0; i < num_ues; ++i) {
+        double x = (double)ues[i].bits_delivered;
+        sum  += x;
+        sum2 += x * x;
+    }
+    if (num_ues <= 0 || sum2 <= 0.0) return 0.0;
+    return (sum * sum) / ((double)num_ues * sum2);
+}
+
+// ----------------- JSON summary -----------------
+
+static void json_hist(FILE *f, const Metrics *m, const LatHist *h) {
+    fprintf(f, "{\"count\":%lld,\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld}",
+            h->count, metrics_lat_us(m, h, 0.50), metrics_lat_us(m, h, 0.99),
+            metrics_lat_us(m, h, 0.999), h->max * m->lat_unit_us);
+}
+
+int metrics_write_json(const Metrics *m, const Config *cfg, const UE *ues, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[warn] cannot write summary %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    fprintf(f, "{\"ttis\":%d,\"ues\":%d,\"rb\":%d,\"seed\":%u,\"phy_mode\":%d,\n",
+            cfg->ttis, cfg->num_ues, cfg->rb_total, cfg->seed, cfg->phy_mode);
+    fprintf(f, " \"packets\":%lld,\"misses\":%lld,\"bits_sent\":%lld,\"rb_used\":%lld,\n",
+            m->total_packets, m->deadline_misses, m->total_bits_sent, m->rb_used_total);
+    if (cfg->mu_mimo) fprintf(f, " \"mu_pairs\":%lld,\n", m->mu_pairs);
+    fprintf(f, " \"slot_us\":%d,\"minislot_syms\":%d,\"preempted\":%lld,\n",
+            cfg->slot_us, cfg->minislot_syms, m->preempted);
+    if (cfg->n_carriers > 0) {
+        fprintf(f, " \"carriers\":[");
+        for (int c = 0; c < cfg->n_carriers; ++c) {
+            fprintf(f, "%s{\"rb\":%d,\"snr_off_db\":%.2f,\"rb_used\":%lld,\"bits_sent\":%lld,"
+                       "\"util\":%.6f}", c ? "," : "", cfg->carrier_rb[c], cfg->carrier_snr_off_db[c],
+                    m->ca_rb_used[c], m->ca_bits_sent[c],
+                    (double)m->ca_rb_used[c] / ((double)cfg->ttis * cfg->carrier_rb[c]));
+        }
+        fprintf(f, "],\n");
+    }
+    fprintf(f, " \"jain\":%.6f,\n \"latency_us\":", metrics_jain_index(ues, cfg->num_ues));
+    json_hist(f, m, &m->lat);
+
+    static const char *cls_name[PKT_CLASSES] = { "embb", "urllc" };
+    fprintf(f, ",\n \"classes\":{");
+    for (int c = 0; c < PKT_CLASSES; ++c) {
+        double miss = m->cls_packets[c] > 0
+                    ? (double)m->cls_misses[c] / (double)m->cls_packets[c] : 0.0;
+        fprintf(f, "%s\"%s\":{\"packets\":%lld,\"misses\":%lld,\"miss_rate\":%.6f,\"latency_us\":",
+                c ? "," : "", cls_name[c], m->cls_packets[c], m->cls_misses[c], miss);
+        json_hist(f, m, &m->cls_lat[c]);
+        fprintf(f, "}");
+    }
+    fprintf(f, "}");
+
+    // Time series: only completed slots plus the open one if it has data
+    const TimeSeries *ts = &m->ts;
+    int n = ts->n + (ts->fill > 0 ? 1 : 0);
+    fprintf(f, ",\n \"series\":{\"win\":%d,\"util\":[", ts->win);
+    for (int i = 0; i < n; ++i) {
+        int w = (i == ts->n) ? ts->fill : ts->win;
+        fprintf(f, "%s%.4f", i ? "," : "", (double)ts->rb[i] / ((double)w * cfg->rb_total));
+    }
+    fprintf(f, "],\"queue\":[");
+    for (int i = 0; i < n; ++i) {
+        int w = (i == ts->n) ? ts->fill : ts->win;
+        fprintf(f, "%s%.3f", i ? "," : "", (double)ts->q[i] / (double)w);
+    }
+    fprintf(f, "]},\n \"per_ue\":[\n");
+
+    for (int i = 0; i < cfg->num_ues; ++i) {
+        const UE *u = &ues[i];
+        long long done = u->pkts_delivered + u->pkts_missed;
+        double miss = done > 0 ? (double)u->pkts_missed / (double)done : 0.0;
+        double tput = (double)u->bits_delivered / (double)cfg->ttis; // bits per slot
+        fprintf(f, "  {\"ue\":%d,\"tput_bits_per_tti\":%.2f,\"delivered\":%lld,\"missed\":%lld,"
+                   "\"miss_rate\":%.6f,\"latency_us\":",
+                i, tput, u->pkts_delivered, u->pkts_missed, miss);
+        json_hist(f, m, &m->ue_lat[i]);
+        fprintf(f, "}%s\n", i + 1 < cfg->num_ues ? "," : "");
+    }
+    fprintf(f, " ]}\n");
+    fclose(f);
+    return 0;
 }
@@ -0,0 +1,177 @@
+#define _GNU_SOURCE
+#include "perfctr.h"
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static const char *stage_name[PC_STAGES] = {
+    "harq", "phy", "arrivals", "expiry", "schedule", "logging"
+};
+
+static long long mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int perf_open(uint32_t type, uint64_t config, int group_fd) {
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = type;
+    a.config = config;
+    a.disabled = group_fd == -1;     // the leader starts the whole group
+    a.exclude_kernel = 1;            // allowed at perf_event_paranoid <= 2
+    a.exclude_hv = 1;
+    a.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                    PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, group_fd, 0);
+}
+
+int perfctr_open(PerfCtr *pc, const char *clock_only) {
+    static const struct { uint32_t type; uint64_t config; } ev[PC_EVENTS] = {
+        [PC_CYCLES]   = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        [PC_INSTR]    = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        [PC_L1D_MISS] = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        [PC_LLC_MISS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        [PC_BR_MISS]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    memset(pc, 0, sizeof(*pc));
+    pc->leader = -1;
+    for (int e = 0; e < PC_EVENTS; ++e) {
+        pc->fd[e] = -1;
+        pc->slot[e] = -1;
+    }
+    if (clock_only) {
+        snprintf(pc->why, sizeof(pc->why), "%s", clock_only);
+        fprintf(stderr, "[info] hardware counters disabled (%s): clock-only stage timing\n",
+                clock_only);
+        return -1;
+    }
+
+    int err = 0;
+    for (int e = 0; e < PC_EVENTS; ++e) {
+        pc->fd[e] = perf_open(ev[e].type, ev[e].config, pc->leader);
+        pc->slot[e] = -1;
+        if (pc->fd[e] < 0) {
+            if (!err) err = errno;
+            continue;
+        }
+        if (pc->leader < 0) pc->leader = pc->fd[e];
+        pc->slot[e] = pc->n_open++;
+    }
+    if (pc->leader < 0) {
+        snprintf(pc->why, sizeof(pc->why), "perf_event_open: %s", strerror(err));
+        fprintf(stderr, "[info] hardware counters unavailable (%s): clock-only stage timing\n",
+                strerror(err));
+        return -1;
+    }
+    if (pc->n_open < PC_EVENTS) {
+        fprintf(stderr, "[info] %d of %d hardware counters available (%s)\n",
+                pc->n_open, PC_EVENTS, strerror(err));
+    }
+    ioctl(pc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    pc->hw = 1;
+    return 0;
+}
+
+void perfctr_close(PerfCtr *pc) {
+    for (int e = 0; e < PC_EVENTS; ++e) {
+        if (pc->fd[e] >= 0 && pc->fd[e] != pc->leader) close(pc->fd[e]);
+        pc->fd[e] = -1;
+    }
+    if (pc->leader >= 0) close(pc->leader);
+    pc->leader = -1;
+    pc->hw = 0;
+}
+
+// A failed read keeps the previous counter values (zero delta)
+static void perf_read(PerfCtr *pc, PerfSample *out) {
+    out->ns = mono_ns();
+    if (!pc->hw) return;
+
+    // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+    uint64_t buf[3 + PC_EVENTS];
+    ssize_t want = (ssize_t)((3 + pc->n_open) * sizeof(uint64_t));
+    if (read(pc->leader, buf, sizeof(buf)) < want) {
+        memcpy(out->ev, pc->last.ev, sizeof(out->ev));
+        return;
+    }
+    pc->time_enabled = (long long)buf[1];
+    pc->time_running = (long long)buf[2];
+    for (int e = 0; e < PC_EVENTS; ++e) {
+        if (pc->slot[e] >= 0) out->ev[e] = (long long)buf[3 + pc->slot[e]];
+    }
+}
+
+void perfctr_start(PerfCtr *pc) {
+    pc->steps++;
+    perf_read(pc, &pc->last);
+}
+
+void perfctr_mark(PerfCtr *pc, PerfStage st) {
+    PerfSample now = {0};
+    perf_read(pc, &now);
+    PerfSample *a = &pc->acc[st];
+    a->ns += now.ns - pc->last.ns;
+    if (pc->hw) {
+        for (int e = 0; e < PC_EVENTS; ++e) a->ev[e] += now.ev[e] - pc->last.ev[e];
+    }
+    pc->last = now;
+}
+
+// Misses per UE per TTI, or "-" when the event could not be opened
+static void print_per_ue(const PerfCtr *pc, PerfEvent e, long long v, double ue_ttis) {
+    if (pc->slot[e] < 0) printf(" %10s", "-");
+    else                 printf(" %10.4f", (double)v / ue_ttis);
+}
+
+void perfctr_print(const PerfCtr *pc, int num_ues) {
+    if (pc->steps == 0) return;
+    // a group the PMU could never schedule reads as zeros
+    const bool hw = pc->hw && pc->time_running > 0;
+    const double steps = (double)pc->steps;
+    const double ue_ttis = steps * (double)(num_ues > 0 ? num_ues : 1);
+
+    PerfSample tot = {0};
+    for (int s = 0; s < PC_STAGES; ++s) {
+        tot.ns += pc->acc[s].ns;
+        for (int e = 0; e < PC_EVENTS; ++e) tot.ev[e] += pc->acc[s].ev[e];
+    }
+
+    if (hw) {
+        printf("Stage cost (hardware counters; misses per UE per TTI):\n");
+        if (pc->time_running < pc->time_enabled) {
+            printf("  [counters multiplexed: running %.1f%% of the time, values not scaled]\n",
+                   100.0 * (double)pc->time_running / (double)pc->time_enabled);
+        }
+        printf("  %-9s %9s %7s %6s %10s %10s %10s\n",
+               "stage", "us/TTI", "share", "IPC", "L1D-miss", "LLC-miss", "br-miss");
+    } else {
+        printf("Stage cost (clock only: %s):\n",
+               pc->hw ? "counters never scheduled" : pc->why);
+        printf("  %-9s %9s %7s\n", "stage", "us/TTI", "share");
+    }
+
+    for (int s = 0; s <= PC_STAGES; ++s) {
+        const PerfSample *a = s < PC_STAGES ? &pc->acc[s] : &tot;
+        printf("  %-9s %9.3f %6.1f%%", s < PC_STAGES ? stage_name[s] : "total",
+               (double)a->ns / 1e3 / steps,
+               tot.ns > 0 ? 100.0 * (double)a->ns / (double)tot.ns : 0.0);
+        if (hw) {
+            if (pc->slot[PC_CYCLES] >= 0 && pc->slot[PC_INSTR] >= 0 && a->ev[PC_CYCLES] > 0)
+                printf(" %6.2f", (double)a->ev[PC_INSTR] / (double)a->ev[PC_CYCLES]);
+            else
+                printf(" %6s", "-");
+            print_per_ue(pc, PC_L1D_MISS, a->ev[PC_L1D_MISS], ue_ttis);
+            print_per_ue(pc, PC_LLC_MISS, a->ev[PC_LLC_MISS], ue_ttis);
+            print_per_ue(pc, PC_BR_MISS,  a->ev[PC_BR_MISS],  ue_ttis);
+        }
+        printf("\n");
+    }
+}
@@ -6,20 +6,29 @@ static inline double clamp(double x, double lo, double hi) {
     return x < lo ? lo : (x > hi ? hi : x);
 }
 
+// xorshift64* uniform in (0,1) from the PHY's own stream
+static double phy_uniform01(Phy *p) {
+    p->rng ^= p->rng >> 12;
+    p->rng ^= p->rng << 25;
+    p->rng ^= p->rng >> 27;
+    uint64_t x = p->rng * 0x2545F4914F6CDD1DULL;
+    return ((double)(x >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
 // Simple random normal via Box-Muller (for shadowing / fading innovation)
-static double rng_norm() {
-    double u1 = rng_uniform01();
-    double u2 = rng_uniform01();
+static double rng_norm(Phy *p) {
+    double u1 = phy_uniform01(p);
+    double u2 = phy_uniform01(p);
     double r = sqrt(-2.0 * log(u1 + 1e-12));
     double th = 2.0 * M_PI * u2;
     return r * cos(th);
 }
 
 // Very simple placement: distance in [0.5, 1.5] cell radii
-static double draw_distance() {
+static double draw_distance(Phy *p) {
     // Area-uniform in annulus [r1, r2]
     double r1 = 0.5, r2 = 1.5;
-    double u  = rng_uniform01();
+    double u  = phy_uniform01(p);
     return sqrt(u*(r2*r2 - r1*r1) + r1*r1);
 }
 
@@ -50,36 +59,75 @@ int phy_bits_per_rb_for_cqi(int cqi) {
 }
 
 void phy_init(Phy *p, const Config *cfg, int num_ues, unsigned int seed) {
-    (void)seed; // rng_seed already set by caller
     p->num_ues = num_ues;
+    p->rng = 0x9E3779B97F4A7C15ULL * ((uint64_t)seed + 1); // never zero
     p->ue = (PhyUEState*)calloc(num_ues, sizeof(PhyUEState));
     for (int i = 0; i < num_ues; ++i) {
-        double d = draw_distance(); // arbitrary units
+        double d = draw_distance(p); // arbitrary units
         double pl = 10.0 * cfg->pathloss_exp * log10(d);
-        double sh = cfg->shadowing_std_db * rng_norm(); // log-normal in dB (approx)
+        double sh = cfg->shadowing_std_db * rng_norm(p); // log-normal in dB (approx)
         p->ue[i].pathloss_db = pl;
         p->ue[i].shadow_db   = sh;
         p->ue[i].fading_state = 0.0; // start at 0
+        p->ue[i].last_tti = -1;
+    }
+
+    p->sig_re = p->sig_im = NULL;
+    if (cfg->mu_mimo) {
+        // Separate stream so enabling MU-MIMO doesn't shift the fading draws
+        Phy sig = { .rng = p->rng ^ 0xA5A5A5A5DEADBEEFULL };
+        p->sig_re = (float*)malloc((size_t)MU_ANT * num_ues * sizeof(float));
+        p->sig_im = (float*)malloc((size_t)MU_ANT * num_ues * sizeof(float));
+        for (int i = 0; i < num_ues; ++i) {
+            // i.i.d. Rayleigh entries, normalised so |h_i^H h_j| is a correlation
+            double re[MU_ANT], im[MU_ANT], norm = 0.0;
+            for (int a = 0; a < MU_ANT; ++a) {
+                re[a] = rng_norm(&sig);
+                im[a] = rng_norm(&sig);
+                norm += re[a]*re[a] + im[a]*im[a];
+            }
+            norm = sqrt(norm);
+            for (int a = 0; a < MU_ANT; ++a) {
+                p->sig_re[a * num_ues + i] = (float)(re[a] / norm);
+                p->sig_im[a * num_ues + i] = (float)(im[a] / norm);
+            }
+        }
     }
 }
 
 void phy_free(Phy *p) {
     if (!p) return;
     free(p->ue);
+    free(p->sig_re);
+    free(p->sig_im);
     p->ue = NULL;
+    p->sig_re = p->sig_im = NULL;
     p->num_ues = 0;
 }
 
 void phy_step(Phy *p, const Config *cfg, int now_tti) {
     (void)now_tti;
-    double rho = clamp(cfg->fading_rho, 0.0, 0.999);
+    double rho = clamp(cfg->fading_rho, 0.0, 1.0);   // per slot, clamped per ms by the config check
     double sigma = sqrt(fmax(1e-9, 1.0 - rho*rho)); // innovation std
     for (int i = 0; i < p->num_ues; ++i) {
-        double z = rng_norm();
+        double z = rng_norm(p);
         p->ue[i].fading_state = rho * p->ue[i].fading_state + sigma * z;
+        p->ue[i].last_tti = now_tti;
     }
 }
 
+void phy_advance_ue(Phy *p, const Config *cfg, int ue_id, int now_tti) {
+    PhyUEState *st = &p->ue[ue_id];
+    int k = now_tti - st->last_tti;
+    if (k <= 0) return;
+    double rho = clamp(cfg->fading_rho, 0.0, 1.0);
+    // k AR(1) steps collapse to x' = rho^k x + sqrt(1 - rho^2k) z
+    double rho_k = (k == 1) ? rho : pow(rho, (double)k);
+    double sigma = sqrt(fmax(1e-9, 1.0 - rho_k*rho_k));
+    st->fading_state = rho_k * st->fading_state + sigma * rng_norm(p);
+    st->last_tti = now_tti;
+}
+
 static double per_rb_from_sinr(double sinr_db, double floor_perr) {
     // Simple logistic PER curve centered near ~8 dB with slope ~0.8
     double snr50 = 8.0;
@@ -96,6 +144,10 @@ void phy_get_instant(const Phy *p, const Config *cfg, int ue_id, PhyUEInstant *o
     // Convert fading_state (~N(0,1)) to dB ripple ~ ± a few dB
     double fading_db = 3.0 * st->fading_state; // scale for visibility
     double sinr_db = cfg->snr_ref_db - st->pathloss_db - st->shadow_db + fading_db;
+    phy_instant_from_sinr(cfg, sinr_db, out);
+}
+
+void phy_instant_from_sinr(const Config *cfg, double sinr_db, PhyUEInstant *out) {
     sinr_db = clamp(sinr_db, -10.0, 30.0);
 
     int cqi = phy_map_sinr_to_cqi(sinr_db);
@@ -112,3 +164,32 @@ void phy_get_instant(const Phy *p, const Config *cfg, int ue_id, PhyUEInstant *o
 void phy_on_retx(Phy *p, int ue_id, int retx_count) {
     (void)p; (void)ue_id; (void)retx_count;
 }
+
+void phy_snapshot_alloc(PhySnapshot *snap, int num_ues) {
+    snap->tti         = -1;
+    snap->sinr_db     = (double*)calloc(num_ues, sizeof(double));
+    snap->cqi         = (int*)calloc(num_ues, sizeof(int));
+    snap->bits_per_rb = (int*)calloc(num_ues, sizeof(int));
+    snap->rb_err_prob = (double*)calloc(num_ues, sizeof(double));
+}
+
+void phy_snapshot_free(PhySnapshot *snap) {
+    free(snap->sinr_db);
+    free(snap->cqi);
+    free(snap->bits_per_rb);
+    free(snap->rb_err_prob);
+    memset(snap, 0, sizeof(*snap));
+}
+
+void phy_compute_snapshot(Phy *p, const Config *cfg, int now_tti, PhySnapshot *snap) {
+    phy_step(p, cfg, now_tti);
+    for (int i = 0; i < p->num_ues; ++i) {
+        PhyUEInstant inst;
+        phy_get_instant(p, cfg, i, &inst);
+        snap->sinr_db[i]     = inst.sinr_db;
+        snap->cqi[i]         = inst.cqi;
+        snap->bits_per_rb[i] = inst.bits_per_rb;
+        snap->rb_err_prob[i] = inst.rb_err_prob;
+    }
+    snap->tti = now_tti;
+}
@@ -0,0 +1,65 @@
+#define _POSIX_C_SOURCE 200809L
+#include "phypipe.h"
+#include <sched.h>
+
+static void pipe_backoff(unsigned *spins) {
+    if (++*spins < 128) return;
+    sched_yield();
+}
+
+static void *phypipe_main(void *arg) {
+    PhyPipe *pp = (PhyPipe*)arg;
+    for (int t = 0; t < pp->cfg->ttis; ++t) {
+        if (atomic_load_explicit(&pp->stop, memory_order_relaxed)) return NULL;
+        // buf[t & 1] is free once main has released TTI t - 2
+        unsigned spins = 0;
+        while (t - atomic_load_explicit(&pp->consumed, memory_order_acquire) >= 2) {
+            if (atomic_load_explicit(&pp->stop, memory_order_relaxed)) return NULL;
+            pipe_backoff(&spins);
+        }
+        phy_compute_snapshot(pp->phy, pp->cfg, t, &pp->buf[t & 1]);
+        atomic_store_explicit(&pp->produced, t + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+int phypipe_start(PhyPipe *pp, Phy *phy, const Config *cfg) {
+    memset(pp, 0, sizeof(*pp));
+    pp->phy = phy;
+    pp->cfg = cfg;
+    phy_snapshot_alloc(&pp->buf[0], phy->num_ues);
+    phy_snapshot_alloc(&pp->buf[1], phy->num_ues);
+    atomic_init(&pp->produced, 0);
+    atomic_init(&pp->consumed, 0);
+    atomic_init(&pp->stop, 0);
+    int rc = pthread_create(&pp->thread, NULL, phypipe_main, pp);
+    if (rc != 0) {
+        fprintf(stderr, "[warn] PHY pipeline thread: %s, running serially\n", strerror(rc));
+        phy_snapshot_free(&pp->buf[0]);
+        phy_snapshot_free(&pp->buf[1]);
+        return -1;
+    }
+    pp->running = 1;
+    return 0;
+}
+
+void phypipe_stop(PhyPipe *pp) {
+    if (!pp->running) return;
+    atomic_store_explicit(&pp->stop, 1, memory_order_relaxed);
+    pthread_join(pp->thread, NULL);
+    phy_snapshot_free(&pp->buf[0]);
+    phy_snapshot_free(&pp->buf[1]);
+    pp->running = 0;
+}
+
+const PhySnapshot *phypipe_acquire(PhyPipe *pp, int tti) {
+    if (tti >= pp->cfg->ttis) return NULL;   // the helper stops at ttis
+    unsigned spins = 0;
+    while (atomic_load_explicit(&pp->produced, memory_order_acquire) <= tti)
+        pipe_backoff(&spins);
+    return &pp->buf[tti & 1];
+}
+
+void phypipe_release(PhyPipe *pp, int tti) {
+    atomic_store_explicit(&pp->consumed, tti + 1, memory_order_release);
+}
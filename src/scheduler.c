@@ -1,5 +1,9 @@
 #include "scheduler.h"
 #include "metrics.h"
+#include "phy.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Keep legacy mapping available; scheduler prefers UE.bprb_cur when set
 int bits_per_rb_for_cqi(int cqi) {
@@ -15,15 +19,15 @@ int bits_per_rb_for_cqi(int cqi) {
 static bool ue_has_data(const UE *u) { return u->q_count > 0; }
 
 // Pick UE with earliest deadline (head-of-line) among non-empty queues
-static int pick_earliest_deadline(UE *ues, int num_ues, int now_tti) {
-    (void)now_tti; // not used yet
+static int pick_earliest_deadline(UE *ues, int num_ues, long long now_us) {
+    (void)now_us; // not used yet
     int best = -1;
-    int best_deadline = 0;
+    long long best_deadline = 0;
     for (int i = 0; i < num_ues; ++i) {
         UE *u = &ues[i];
         if (!ue_has_data(u)) continue;
         Packet *p = &u->q[u->q_head];
-        int d = p->deadline_tti;
+        long long d = p->deadline_us;
         if (best < 0 || d < best_deadline) {
             best = i;
             best_deadline = d;
@@ -32,63 +36,420 @@ static int pick_earliest_deadline(UE *ues, int num_ues, int now_tti) {
     return best;
 }
 
+// Prefer PHY-provided bprb_cur; fallback to legacy mapping
+static int ue_bprb(const UE *u) {
+    return (u->bprb_cur > 0) ? u->bprb_cur : bits_per_rb_for_cqi(u->cqi);
+}
+
+// Serve the HoL packet of u at bprb bits per RB with at most rb_budget RBs.
+// Returns bits sent; *rb_taken is set to the RBs consumed.
+static int serve_hol(
+    UE *u, int bprb, int rb_budget, int *rb_taken,
+    Completion *comps, int comps_cap, int *comps_used
+) {
+    Packet *p = &u->q[u->q_head];
+
+    if (bprb <= 0) { *rb_taken = 1; return 0; }
+
+    int rb_needed = (p->bits + bprb - 1) / bprb;
+    if (rb_needed <= 0) rb_needed = 1;
+    int rb_alloc = rb_needed <= rb_budget ? rb_needed : rb_budget;
+    int bits_this = rb_alloc * bprb;
+
+    u->dbg_was_scheduled = 1;
+    u->dbg_tx_bits_this_tti += bits_this;
+    u->dbg_rb_this_tti += rb_alloc;
+
+    p->bits -= bits_this;
+    u->bits_sent_total += bits_this;
+
+    if (p->bits <= 0) {
+        int pkt_size_bits = bits_this + (p->bits < 0 ? p->bits : 0);
+        if (pkt_size_bits < 0) pkt_size_bits = 0;
+
+        // Record completion for HARQ (with TX-time PHY context)
+        if (*comps_used < comps_cap) {
+            Completion *c = &comps[*comps_used];
+            c->ue_id = u->id;
+            c->pkt_arrival_us   = p->arrival_us;
+            c->pkt_deadline_us  = p->deadline_us;
+            c->pkt_size_bits    = pkt_size_bits;
+            c->pkt_cls          = p->cls;
+            c->tx_us            = 0;
+            c->preempted        = 0;
+
+            c->rb_alloc         = rb_alloc;
+            c->cqi_at_tx        = u->cqi;
+            c->sinr_db_at_tx    = u->sinr_db_cur;
+            c->rb_err_prob_at_tx= u->rb_err_prob_cur;
+
+            (*comps_used)++;
+        }
+
+        // Pop finished packet
+        u->q_head = (u->q_head + 1) % MAX_QUEUE;
+        u->q_count--;
+    }
+
+    *rb_taken = rb_alloc;
+    return bits_this;
+}
+
+// EDF loop; when order is set, every pick is appended to it as a grant
+// (consecutive picks of one UE merged)
+static int edf_run(
+    UE *ues, int num_ues, int rb_budget, long long now_us, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used, Grant *order, int *num_order
+) {
+    int bits_sent_total = 0;
+    int rb_used = 0;
+    int n_order = 0;
+    *comps_used = 0;
+
+    while (rb_budget > 0) {
+        int idx = pick_earliest_deadline(ues, num_ues, now_us);
+        if (idx < 0) break;
+
+        int rb_alloc = 0;
+        bits_sent_total += serve_hol(&ues[idx], ue_bprb(&ues[idx]), rb_budget, &rb_alloc,
+                                     comps, comps_cap, comps_used);
+        rb_budget -= rb_alloc;
+        rb_used   += rb_alloc;
+
+        if (order) {
+            if (n_order > 0 && order[n_order - 1].ue_id == idx) order[n_order - 1].rb += rb_alloc;
+            else order[n_order++] = (Grant){ .ue_id = idx, .rb = rb_alloc };
+        }
+    }
+
+    if (rb_used_out) *rb_used_out = rb_used;
+    if (num_order) *num_order = n_order;
+    return bits_sent_total;
+}
+
 int schedule_edf(
-    UE *ues, int num_ues, int rb_budget, int now_tti, Metrics *m, int *rb_used_out,
+    UE *ues, int num_ues, int rb_budget, long long now_us, Metrics *m, int *rb_used_out,
     Completion *comps, int comps_cap, int *comps_used
 ) {
     (void)m;
+    return edf_run(ues, num_ues, rb_budget, now_us, rb_used_out,
+                   comps, comps_cap, comps_used, NULL, NULL);
+}
+
+int schedule_edf_order(
+    UE *ues, int num_ues, int rb_budget, long long now_us, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used, Grant *order, int *num_order
+) {
+    return edf_run(ues, num_ues, rb_budget, now_us, rb_used_out,
+                   comps, comps_cap, comps_used, order, num_order);
+}
+
+int schedule_grants(
+    UE *ues, int num_ues, const Grant *grants, int num_grants,
+    int rb_budget, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used
+) {
+    int bits_sent_total = 0;
+    int rb_used = 0;
+    *comps_used = 0;
+
+    for (int g = 0; g < num_grants && rb_budget > 0; ++g) {
+        const Grant *gr = &grants[g];
+        if (gr->ue_id < 0 || gr->ue_id >= num_ues) continue;
+        UE *u = &ues[gr->ue_id];
+        int rb_left = gr->rb < rb_budget ? gr->rb : rb_budget;
+
+        // A grant may span several packets of the same UE
+        while (rb_left > 0 && ue_has_data(u)) {
+            int rb_alloc = 0;
+            bits_sent_total += serve_hol(u, ue_bprb(u), rb_left, &rb_alloc,
+                                         comps, comps_cap, comps_used);
+            rb_left   -= rb_alloc;
+            rb_budget -= rb_alloc;
+            rb_used   += rb_alloc;
+        }
+    }
+
+    if (rb_used_out) *rb_used_out = rb_used;
+    return bits_sent_total;
+}
+
+// ----------------- MU-MIMO -----------------
+
+#define MU_SIMD 4   // candidates per correlation step (one SSE register)
+
+void mu_init(MuMimo *mu, const Config *cfg, const float *sig_re, const float *sig_im, int num_ues) {
+    memset(mu, 0, sizeof(*mu));
+    mu->cfg      = cfg;
+    mu->sig_re   = sig_re;
+    mu->sig_im   = sig_im;
+    mu->num_ues  = num_ues;
+    mu->corr_th2 = (float)(cfg->mu_corr_th * cfg->mu_corr_th);
+    mu->cand_max = (cfg->mu_cand_max > 0 && cfg->mu_cand_max < num_ues) ? cfg->mu_cand_max : num_ues;
+
+    int pad = (mu->cand_max + MU_SIMD - 1) / MU_SIMD * MU_SIMD;
+    mu->cand   = (int*)malloc((size_t)mu->cand_max * sizeof(int));
+    mu->cre    = (float*)calloc((size_t)MU_ANT * pad, sizeof(float));
+    mu->cim    = (float*)calloc((size_t)MU_ANT * pad, sizeof(float));
+    mu->corr2  = (float*)calloc((size_t)pad, sizeof(float));
+    mu->paired = (unsigned char*)calloc((size_t)num_ues, 1);
+}
+
+void mu_free(MuMimo *mu) {
+    free(mu->cand);
+    free(mu->cre);
+    free(mu->cim);
+    free(mu->corr2);
+    free(mu->paired);
+    memset(mu, 0, sizeof(*mu));
+}
+
+static long long hol_deadline(const UE *u) { return u->q[u->q_head].deadline_us; }
+
+// Keep the cand_max earliest-deadline UEs with data (ties: lower id first),
+// sorted, and gather their signatures antenna-major for the SIMD kernel.
+// Most UEs are rejected by a single compare against the current worst.
+static void mu_gather_candidates(MuMimo *mu, const UE *ues, int num_ues) {
+    int n = 0;
+    for (int i = 0; i < num_ues; ++i) {
+        if (!ue_has_data(&ues[i])) continue;
+        long long d = hol_deadline(&ues[i]);
+        if (n == mu->cand_max && d >= hol_deadline(&ues[mu->cand[n - 1]])) continue;
+        int k = (n < mu->cand_max) ? n++ : n - 1;
+        while (k > 0 && hol_deadline(&ues[mu->cand[k - 1]]) > d) {
+            mu->cand[k] = mu->cand[k - 1];
+            --k;
+        }
+        mu->cand[k] = i;
+    }
+    mu->n_cand   = n;
+    mu->cand_pad = (n + MU_SIMD - 1) / MU_SIMD * MU_SIMD;
+
+    const int P = mu->cand_pad;
+    for (int a = 0; a < MU_ANT; ++a) {
+        const float *sr = mu->sig_re + (size_t)a * num_ues;
+        const float *si = mu->sig_im + (size_t)a * num_ues;
+        float *cr = mu->cre + (size_t)a * P;
+        float *ci = mu->cim + (size_t)a * P;
+        for (int k = 0; k < n; ++k) {
+            cr[k] = sr[mu->cand[k]];
+            ci[k] = si[mu->cand[k]];
+        }
+        for (int k = n; k < P; ++k) cr[k] = ci[k] = 0.0f;
+    }
+}
+
+static void mu_primary(const MuMimo *mu, int p, float pr[MU_ANT], float pi[MU_ANT]) {
+    for (int a = 0; a < MU_ANT; ++a) {
+        pr[a] = mu->sig_re[(size_t)a * mu->num_ues + p];
+        pi[a] = mu->sig_im[(size_t)a * mu->num_ues + p];
+    }
+}
+
+void mu_correlate_scalar(MuMimo *mu, int p) {
+    const int P = mu->cand_pad;
+    float pr[MU_ANT], pi[MU_ANT];
+    mu_primary(mu, p, pr, pi);
+    for (int k = 0; k < P; ++k) {
+        float re = 0.0f, im = 0.0f;
+        for (int a = 0; a < MU_ANT; ++a) {
+            float cr = mu->cre[(size_t)a * P + k], ci = mu->cim[(size_t)a * P + k];
+            re += pr[a] * cr + pi[a] * ci;
+            im += pr[a] * ci - pi[a] * cr;
+        }
+        mu->corr2[k] = re * re + im * im;
+    }
+}
+
+void mu_correlate(MuMimo *mu, int p) {
+#if defined(__SSE2__)
+    const int P = mu->cand_pad;
+    float pr[MU_ANT], pi[MU_ANT];
+    mu_primary(mu, p, pr, pi);
+    // Four candidates per register; conj(h_p) * h_k = (pr*cr + pi*ci) + j(pr*ci - pi*cr)
+    for (int k = 0; k < P; k += MU_SIMD) {
+        __m128 acc_re = _mm_setzero_ps();
+        __m128 acc_im = _mm_setzero_ps();
+        for (int a = 0; a < MU_ANT; ++a) {
+            __m128 hr = _mm_set1_ps(pr[a]);
+            __m128 hi = _mm_set1_ps(pi[a]);
+            __m128 cr = _mm_loadu_ps(mu->cre + (size_t)a * P + k);
+            __m128 ci = _mm_loadu_ps(mu->cim + (size_t)a * P + k);
+            acc_re = _mm_add_ps(acc_re, _mm_add_ps(_mm_mul_ps(hr, cr), _mm_mul_ps(hi, ci)));
+            acc_im = _mm_add_ps(acc_im, _mm_sub_ps(_mm_mul_ps(hr, ci), _mm_mul_ps(hi, cr)));
+        }
+        _mm_storeu_ps(mu->corr2 + k,
+                      _mm_add_ps(_mm_mul_ps(acc_re, acc_re), _mm_mul_ps(acc_im, acc_im)));
+    }
+#else
+    mu_correlate_scalar(mu, p);
+#endif
+}
+
+// SINR of one stream of a pair: half the power each, plus leakage of the
+// other stream scaled by the squared correlation.
+static void mu_degrade(const MuMimo *mu, const UE *u, float corr2, PhyUEInstant *out) {
+    double s = 0.5 * pow(10.0, u->sinr_db_cur / 10.0);
+    double sinr = s / (1.0 + (double)corr2 * s);
+    phy_instant_from_sinr(mu->cfg, 10.0 * log10(sinr), out);
+}
+
+// Expected ACKed bits per RB for u's HoL TB at the given rate: the TB
+// only survives if all of its RBs do.
+static double mu_goodput_per_rb(const UE *u, int bprb, double rb_err_prob) {
+    if (bprb <= 0) return 0.0;
+    int rb = (u->q[u->q_head].bits + bprb - 1) / bprb;
+    return bprb * pow(1.0 - rb_err_prob, rb > 0 ? rb : 1);
+}
+
+// Earliest-deadline compatible partner for p, or -1. On the shared RBs the
+// pair must beat the expected goodput of either UE served alone, otherwise
+// a good partner could be wasted on a primary that fails anyway.
+static int mu_find_partner(MuMimo *mu, const UE *ues, int p,
+                           PhyUEInstant *ip, PhyUEInstant *iq) {
+    mu_correlate(mu, p);
+    double solo = mu_goodput_per_rb(&ues[p], ues[p].bprb_cur, ues[p].rb_err_prob_cur);
+    for (int k = 0; k < mu->n_cand; ++k) {
+        int q = mu->cand[k];
+        if (q == p || mu->paired[q] || !ue_has_data(&ues[q])) continue;
+        if (mu->corr2[k] >= mu->corr_th2) continue;
+        double best = fmax(solo, mu_goodput_per_rb(&ues[q], ues[q].bprb_cur, ues[q].rb_err_prob_cur));
+        mu_degrade(mu, &ues[p], mu->corr2[k], ip);
+        mu_degrade(mu, &ues[q], mu->corr2[k], iq);
+        if (mu_goodput_per_rb(&ues[p], ip->bits_per_rb, ip->rb_err_prob) +
+            mu_goodput_per_rb(&ues[q], iq->bits_per_rb, iq->rb_err_prob) > best) return q;
+    }
+    return -1;
+}
+
+static void ue_get_instant(const UE *u, PhyUEInstant *out) {
+    out->cqi         = u->cqi;
+    out->bits_per_rb = u->bprb_cur;
+    out->sinr_db     = u->sinr_db_cur;
+    out->rb_err_prob = u->rb_err_prob_cur;
+}
+
+static void ue_put_instant(UE *u, const PhyUEInstant *in) {
+    u->cqi             = in->cqi;
+    u->bprb_cur        = in->bits_per_rb;
+    u->sinr_db_cur     = in->sinr_db;
+    u->rb_err_prob_cur = in->rb_err_prob;
+}
+
+int schedule_edf_mu(
+    UE *ues, int num_ues, int rb_budget, long long now_us, Metrics *m, MuMimo *mu,
+    int *rb_used_out, Completion *comps, int comps_cap, int *comps_used
+) {
     int bits_sent_total = 0;
     int rb_used = 0;
     *comps_used = 0;
 
+    memset(mu->paired, 0, (size_t)num_ues);
+    mu_gather_candidates(mu, ues, num_ues);
+
     while (rb_budget > 0) {
-        int idx = pick_earliest_deadline(ues, num_ues, now_tti);
+        int idx = pick_earliest_deadline(ues, num_ues, now_us);
         if (idx < 0) break;
 
-        UE *u = &ues[idx];
-        Packet *p = &u->q[u->q_head];
+        UE *p = &ues[idx];
+        PhyUEInstant ip, iq, saved_p, saved_q;
+        int q = (!mu->paired[idx] && mu->n_cand > 1)
+              ? mu_find_partner(mu, ues, idx, &ip, &iq) : -1;
 
-        // Prefer PHY-provided bprb_cur; fallback to legacy mapping
-        int bprb = (u->bprb_cur > 0) ? u->bprb_cur : bits_per_rb_for_cqi(u->cqi);
-        if (bprb <= 0) { rb_budget--; rb_used++; continue; }
+        int rb_alloc = 0;
+        if (q < 0) {
+            bits_sent_total += serve_hol(p, ue_bprb(p), rb_budget, &rb_alloc,
+                                         comps, comps_cap, comps_used);
+        } else {
+            // Both streams go out on the primary's RBs at the degraded rates;
+            // completions keep the degraded SINR so HARQ sees the cross-talk.
+            UE *pq = &ues[q];
+            ue_get_instant(p, &saved_p);
+            ue_get_instant(pq, &saved_q);
 
-        int rb_needed = (p->bits + bprb - 1) / bprb;
-        if (rb_needed <= 0) rb_needed = 1;
-        int rb_alloc = rb_needed <= rb_budget ? rb_needed : rb_budget;
-        int bits_this = rb_alloc * bprb;
+            ue_put_instant(p, &ip);
+            bits_sent_total += serve_hol(p, ue_bprb(p), rb_budget, &rb_alloc,
+                                         comps, comps_cap, comps_used);
+            ue_put_instant(pq, &iq);
+            int rb_shared = 0;
+            bits_sent_total += serve_hol(pq, ue_bprb(pq), rb_alloc, &rb_shared,
+                                         comps, comps_cap, comps_used);
 
-        u->dbg_was_scheduled = 1;
-        u->dbg_tx_bits_this_tti += bits_this;
+            ue_put_instant(p, &saved_p);
+            ue_put_instant(pq, &saved_q);
+            mu->paired[idx] = mu->paired[q] = 1;
+            if (m) m->mu_pairs++;
+        }
+        rb_budget -= rb_alloc;
+        rb_used   += rb_alloc;
+    }
 
-        p->bits -= bits_this;
-        u->bits_sent_total += bits_this;
+    if (rb_used_out) *rb_used_out = rb_used;
+    return bits_sent_total;
+}
 
-        if (p->bits <= 0) {
-            int pkt_size_bits = bits_this + (p->bits < 0 ? p->bits : 0);
-            if (pkt_size_bits < 0) pkt_size_bits = 0;
+// ----------------- Mini-slots -----------------
 
-            // Record completion for HARQ (with TX-time PHY context)
-            if (*comps_used < comps_cap) {
-                Completion *c = &comps[*comps_used];
-                c->ue_id = u->id;
-                c->pkt_arrival_tti  = p->arrival_tti;
-                c->pkt_deadline_tti = p->deadline_tti;
-                c->pkt_size_bits    = pkt_size_bits;
+// URLLC packets are kept ahead of eMBB in each queue, so the HoL tells
+static int pick_urgent(UE *ues, int num_ues) {
+    int best = -1;
+    long long best_deadline = 0;
+    for (int i = 0; i < num_ues; ++i) {
+        UE *u = &ues[i];
+        if (!ue_has_data(u)) continue;
+        Packet *p = &u->q[u->q_head];
+        if (p->cls != PKT_URLLC) continue;
+        if (best < 0 || p->deadline_us < best_deadline) {
+            best = i;
+            best_deadline = p->deadline_us;
+        }
+    }
+    return best;
+}
 
-                c->rb_alloc         = rb_alloc;
-                c->cqi_at_tx        = u->cqi;
-                c->sinr_db_at_tx    = u->sinr_db_cur;
-                c->rb_err_prob_at_tx= u->rb_err_prob_cur;
+// Least urgent eMBB TB of this slot that is still intact, or -1
+static int pick_victim(const Completion *comps, int n_victims) {
+    int best = -1;
+    for (int i = 0; i < n_victims; ++i) {
+        const Completion *c = &comps[i];
+        if (c->pkt_cls != PKT_EMBB || c->preempted) continue;
+        if (best < 0 || c->pkt_deadline_us > comps[best].pkt_deadline_us) best = i;
+    }
+    return best;
+}
 
-                (*comps_used)++;
-            }
+int schedule_minislot(
+    UE *ues, int num_ues, int syms, int rb_free, int *rb_preempted,
+    bool preempt, int n_victims, Metrics *m, int *rb_used_out,
+    Completion *comps, int comps_cap, int *comps_used
+) {
+    int bits_sent_total = 0;
+    int rb_used = 0;
+    int rb_budget = rb_free + *rb_preempted;
+
+    for (;;) {
+        int idx = pick_urgent(ues, num_ues);
+        if (idx < 0) break;
+
+        UE *u = &ues[idx];
+        int bprb = ue_bprb(u) * syms / 14;
+        if (bprb < 1) bprb = 1;
+        int rb_needed = (u->q[u->q_head].bits + bprb - 1) / bprb;
 
-            // Pop finished packet
-            u->q_head = (u->q_head + 1) % MAX_QUEUE;
-            u->q_count--;
+        // Puncture eMBB TBs until the urgent packet fits (or none are left)
+        while (preempt && rb_budget < rb_needed) {
+            int v = pick_victim(comps, n_victims);
+            if (v < 0) break;
+            comps[v].preempted = 1;
+            *rb_preempted += comps[v].rb_alloc;
+            rb_budget     += comps[v].rb_alloc;
+            if (m) m->preempted++;
         }
+        if (rb_budget <= 0) break;
 
-        bits_sent_total += bits_this;
+        int rb_alloc = 0;
+        bits_sent_total += serve_hol(u, bprb, rb_budget, &rb_alloc,
+                                     comps, comps_cap, comps_used);
         rb_budget -= rb_alloc;
         rb_used   += rb_alloc;
     }
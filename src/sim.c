@@ -1,6 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include "sim.h"
 #include "scheduler.h"
 #include "metrics.h"
+#include <limits.h>
+
+// Hot-path helpers take the run configuration as compile-time constants and
+// are force-inlined into each specialised sim_step variant (see bottom of
+// the "One TTI" section), so the per-UE loops carry no config branches.
+#define SIM_HOT static inline __attribute__((always_inline))
+
+// Stage boundary for --perf-counters: charges the cost since the last mark
+#define PERF_MARK(s, st) do { if ((s)->perf) perfctr_mark((s)->perf, (st)); } while (0)
+
+static SimStepFn sim_select_step(const Sim *s);
 
 // ----------------- UE queue helpers -----------------
 
@@ -8,6 +20,7 @@ static void ue_queue_init(UE *u) {
     u->q = (Packet*)calloc(MAX_QUEUE, sizeof(Packet));
     u->q_head = u->q_tail = u->q_count = 0;
     u->bits_sent_total = 0;
+    u->bits_delivered = 0;
     u->pkts_delivered = 0;
     u->pkts_missed = 0;
     u->cqi = rng_int(6, 12); // legacy init
@@ -38,12 +51,184 @@ static void ue_queue_pop(UE *u) {
     u->q_count--;
 }
 
+// Insert at the head, but behind the URLLC packets that keep priority:
+// all of them for an eMBB packet, earlier deadlines for a URLLC one.
+// Without URLLC traffic this is a plain push-front.
+static bool ue_queue_push_front(UE *u, Packet p) {
+    if (u->q_count >= MAX_QUEUE) return false;
+    u->q_head = (u->q_head - 1 + MAX_QUEUE) % MAX_QUEUE;
+    u->q_count++;
+    int i = u->q_head;
+    for (int k = 1; k < u->q_count; ++k) {
+        int next = (i + 1) % MAX_QUEUE;
+        const Packet *n = &u->q[next];
+        if (n->cls != PKT_URLLC) break;
+        if (p.cls == PKT_URLLC && n->deadline_us > p.deadline_us) break;
+        u->q[i] = *n;
+        i = next;
+    }
+    u->q[i] = p;
+    return true;
+}
+
 // ----------------- Sim lifecycle -----------------
 
+// Defaults of every option; ttis, rb_total and num_ues are -1 (required)
+void sim_config_defaults(Config *cfg) {
+    *cfg = (Config){
+        .ttis = -1,
+        .rb_total = -1,
+        .num_ues = -1,
+        .seed = 42,
+        .arrival_rate = 0.2,
+        .pkt_bits_min = 800,    // ~100 bytes
+        .pkt_bits_max = 12000,  // ~1500 bytes
+        .deadline_us = 8000,
+        .bler = 0.1,
+        .harq_rtt_us = 8000,
+        .out_dir = "data",
+        .csv_path = NULL,
+        .summary_path = NULL,
+        .log_streams = 0,
+        .log_ues = NULL,
+        .log_every = 1,
+        .log_sample = 0,
+        .ext_shm = NULL,
+        .ext_timeout_ms = 1000,
+        .step_generic = 0,
+        .perf_counters = 0,
+
+        // Numerology / URLLC Defaults
+        .slot_us = 1000,
+        .minislot_syms = 0,
+        .urllc_rate = 0.0,
+        .urllc_bits = 256,
+        .urllc_deadline_us = 1000,
+        .preempt = 0,
+
+        // PHY Defaults
+        .phy_mode = 0, 
+        .pathloss_exp = 3.5,
+        .shadowing_std_db = 6.0,
+        .fading_rho = 0.9,
+        .snr_ref_db = 18.0,
+        .rb_floor_perr = 1e-4,
+        .phy_pipeline = 0,
+        .phy_lazy = 0,
+
+        // MU-MIMO Defaults
+        .mu_mimo = 0,
+        .mu_corr_th = 0.2,
+        .mu_cand_max = 64
+    };
+}
+
+const char *sim_config_error(int err) {
+    switch (err) {
+    case CFG_OK:           return "ok";
+    case CFG_ERR_SIZE:     return "ttis, rb_total and num_ues must be positive";
+    case CFG_ERR_TIME:     return "slot_us and harq_rtt_us must be positive, deadline_us >= 0";
+    case CFG_ERR_MINISLOT: return "mini-slots must be 2, 4 or 7 symbols";
+    case CFG_ERR_CARRIERS: return "1..8 carriers with a positive RB count each";
+    case CFG_ERR_CA_PHY:   return "carrier aggregation needs per-carrier channels (phy_mode 1)";
+    case CFG_ERR_CA_COMBO: return "carrier aggregation cannot be combined with the external "
+                                  "scheduler, MU-MIMO or mini-slots";
+    default:               return "unknown error";
+    }
+}
+
+// Range and combination checks shared by the CLI and l1s_create(). Soft
+// problems are clamped or switched off with an [info]/[warn] note.
+int sim_config_check(Config *cfg) {
+    if (cfg->n_carriers < 0 || cfg->n_carriers > MAX_CARRIERS) return CFG_ERR_CARRIERS;
+    if (cfg->n_carriers > 0) {
+        // the carrier list defines the RB pool
+        int sum = 0;
+        for (int c = 0; c < cfg->n_carriers; ++c) {
+            if (cfg->carrier_rb[c] <= 0) return CFG_ERR_CARRIERS;
+            sum += cfg->carrier_rb[c];
+        }
+        cfg->rb_total = sum;
+    }
+    if (cfg->ttis <= 0 || cfg->rb_total <= 0 || cfg->num_ues <= 0) return CFG_ERR_SIZE;
+    if (cfg->slot_us <= 0 || cfg->deadline_us < 0 || cfg->harq_rtt_us <= 0) return CFG_ERR_TIME;
+    if (cfg->minislot_syms != 0 && cfg->minislot_syms != 2 &&
+        cfg->minislot_syms != 4 && cfg->minislot_syms != 7) return CFG_ERR_MINISLOT;
+    if (cfg->n_carriers > 0) {
+        if (cfg->phy_mode != 1) return CFG_ERR_CA_PHY;
+        if (cfg->ext_shm || cfg->mu_mimo || cfg->minislot_syms > 0) return CFG_ERR_CA_COMBO;
+    }
+
+    // Clamp some PHY params to sane ranges (fading_rho is per ms here,
+    // sim_init() scales it to the slot)
+    if (cfg->fading_rho < 0.0) cfg->fading_rho = 0.0;
+    if (cfg->fading_rho > 0.999) cfg->fading_rho = 0.999;
+    if (cfg->rb_floor_perr < 0.0) cfg->rb_floor_perr = 0.0;
+    if (cfg->rb_floor_perr > 1.0) cfg->rb_floor_perr = 1.0;
+
+    if (cfg->phy_lazy && cfg->phy_pipeline) {
+        // which UEs need a channel depends on this TTI's queues
+        fprintf(stderr, "[info] --phy-lazy needs the current queues: --phy-pipeline disabled\n");
+        cfg->phy_pipeline = 0;
+    }
+    if (cfg->n_carriers > 0 && cfg->phy_pipeline) {
+        fprintf(stderr, "[info] carriers compute their channels on their own threads: "
+                        "--phy-pipeline disabled\n");
+        cfg->phy_pipeline = 0;
+    }
+
+    if (cfg->preempt && cfg->minislot_syms == 0) {
+        fprintf(stderr, "[info] --preempt only acts in mini-slots (--minislot): ignored\n");
+    }
+    if (cfg->urllc_bits <= 0) cfg->urllc_bits = 1;
+
+    if (cfg->mu_mimo && cfg->phy_mode != 1) {
+        fprintf(stderr, "[warn] --mu-mimo needs per-UE channels (--phy-mode 1): disabled\n");
+        cfg->mu_mimo = 0;
+    }
+    if (cfg->mu_mimo && cfg->ext_shm) {
+        fprintf(stderr, "[info] --ext-sched grants take precedence: MU-MIMO pairing only on EDF fallback\n");
+    }
+    if (cfg->mu_corr_th < 0.0) cfg->mu_corr_th = 0.0;
+    if (cfg->mu_corr_th > 1.0) cfg->mu_corr_th = 1.0;
+    if (cfg->mu_cand_max < 1) cfg->mu_cand_max = 1;
+    return CFG_OK;
+}
+
 void sim_init(Sim *s, const Config *cfg) {
     s->cfg = *cfg;
     s->tti = 0;
-    s->m = (Metrics){0};
+
+    // Carrier aggregation needs per-UE channels and replaces the single RB
+    // pool, the MU-MIMO / mini-slot schedulers and the external scheduler
+    if (s->cfg.n_carriers > MAX_CARRIERS) s->cfg.n_carriers = MAX_CARRIERS;
+    if (s->cfg.phy_mode != 1) s->cfg.n_carriers = 0;
+    if (s->cfg.n_carriers > 0) {
+        s->cfg.rb_total = 0;
+        for (int c = 0; c < s->cfg.n_carriers; ++c) s->cfg.rb_total += s->cfg.carrier_rb[c];
+        s->cfg.mu_mimo = s->cfg.minislot_syms = s->cfg.phy_pipeline = 0;
+        s->cfg.ext_shm = NULL;
+    }
+
+    // Time base: slots of slot_us; traffic rates and fading correlation are per ms
+    if (s->cfg.slot_us <= 0) s->cfg.slot_us = 1000;
+    if (s->cfg.minislot_syms < 0 || s->cfg.minislot_syms > 7) s->cfg.minislot_syms = 0;
+    double slot_ms = s->cfg.slot_us / 1000.0;
+    s->p_embb  = fmin(1.0, s->cfg.arrival_rate * slot_ms);
+    s->p_urllc = fmin(1.0, s->cfg.urllc_rate * slot_ms);
+    if (s->cfg.slot_us != 1000) s->cfg.fading_rho = pow(s->cfg.fading_rho, slot_ms);
+    s->pend_cap = s->p_urllc > 0.0 ? cfg->num_ues : 0;
+    s->pend = s->pend_cap ? (PendingPkt*)malloc((size_t)s->pend_cap * sizeof(PendingPkt)) : NULL;
+    s->n_pend = s->pend_next = 0;
+
+    // Slot-aligned traffic only: every latency is k * slot + harq_rtt
+    int lat_unit = 1;
+    if (s->p_urllc == 0.0) {
+        int a = s->cfg.slot_us, b = s->cfg.harq_rtt_us > 0 ? s->cfg.harq_rtt_us : a;
+        while (b) { int t = a % b; a = b; b = t; }
+        lat_unit = a;
+    }
+    metrics_init(&s->m, cfg->num_ues, lat_unit);
     rng_seed(s->cfg.seed);
 
     s->ues = (UE*)calloc(cfg->num_ues, sizeof(UE));
@@ -51,39 +236,79 @@ void sim_init(Sim *s, const Config *cfg) {
         s->ues[i].id = i;
         ue_queue_init(&s->ues[i]);
     }
-    // HARQ ring buffer
-    int cap = s->cfg.ttis * s->cfg.num_ues + 1024;
+    // Per-TTI result buffers
+    // MU-MIMO partners and each mini-slot can complete another rb_total TBs
+    s->comps_cap = s->cfg.mu_mimo ? 2 * s->cfg.rb_total : s->cfg.rb_total;
+    if (s->cfg.minislot_syms > 0) s->comps_cap += (14 / s->cfg.minislot_syms) * s->cfg.rb_total;
+    s->comps  = (Completion*)calloc(s->comps_cap, sizeof(Completion));
+
+    // HARQ ring buffer: every TTI enqueues at most comps_cap events and each
+    // is popped one RTT later (a retransmission is a new completion), so
+    // this holds everything in flight; harq_enqueue grows it regardless
+    int cap = s->comps_cap * (s->cfg.harq_rtt_us / s->cfg.slot_us + 2);
     s->harq_events = (HarqEvent*)calloc(cap, sizeof(HarqEvent));
     s->harq_cap = cap;
     s->harq_head = s->harq_tail = s->harq_count = 0;
-
-    // CSV logging
-    s->csv = NULL;
-    if (cfg->csv_path && *cfg->csv_path) {
-        s->csv = fopen(cfg->csv_path, "w");
-        if (s->csv) {
-            // header
-            fprintf(s->csv, "tti,ue,bits_sent,rb_used,cqi,queue_after,hol_deadline\n");
-            fflush(s->csv);
+    s->allocs = (AllocRecord*)calloc(s->cfg.num_ues, sizeof(AllocRecord));
+    s->n_allocs = 0;
+    s->fb_cap = 64;
+    s->fb = (HarqRecord*)calloc(s->fb_cap, sizeof(HarqRecord));
+    s->n_fb = 0;
+
+    // CSV logging: only the streams that were asked for
+    trace_open(&s->trace, &s->cfg);
+
+    // External scheduler (falls back to EDF if the segment can't be created)
+    s->ext = NULL;
+    if (s->cfg.ext_shm && *s->cfg.ext_shm) {
+        s->ext = (ExtSched*)calloc(1, sizeof(ExtSched));
+        if (ext_sched_open(s->ext, cfg->ext_shm, cfg->num_ues, cfg->rb_total, cfg->ext_timeout_ms) != 0) {
+            free(s->ext);
+            s->ext = NULL;
         }
     }
-    s->evcsv = fopen("data/events.csv", "w");
-    if (s->evcsv) {
-        fprintf(s->evcsv, "tti,event,ue,pkt_bits,retx,sinr_db,cqi,rb_alloc,rb_perr\n");
-        fflush(s->evcsv);
-    }
-    s->chcsv = fopen("data/channel.csv", "w");
-    if (s->chcsv) {
-        fprintf(s->chcsv, "tti,ue,sinr_db,cqi,bits_per_rb,rb_err_prob\n");
-        fflush(s->chcsv);
-    }
 
-    // PHY
-    if (s->cfg.phy_mode == 1) {
+    // PHY (with carrier aggregation every carrier owns its channel; carrier
+    // 0 draws the same stream as the single-carrier Phy)
+    s->ca = NULL;
+    if (s->cfg.n_carriers > 0) {
+        memset(&s->phy, 0, sizeof(s->phy));
+        s->ca = (CarrierSet*)calloc(1, sizeof(CarrierSet));
+        carrier_init(s->ca, &s->cfg, s->cfg.seed ^ 0xC0FFEEu);
+    } else if (s->cfg.phy_mode == 1) {
         phy_init(&s->phy, &s->cfg, s->cfg.num_ues, s->cfg.seed ^ 0xC0FFEEu);
     } else {
         memset(&s->phy, 0, sizeof(s->phy));
     }
+
+    // MU-MIMO pairing over the PHY's spatial signatures
+    s->mu = NULL;
+    if (s->cfg.phy_mode == 1 && s->cfg.mu_mimo) {
+        s->mu = (MuMimo*)calloc(1, sizeof(MuMimo));
+        mu_init(s->mu, &s->cfg, s->phy.sig_re, s->phy.sig_im, s->cfg.num_ues);
+    }
+
+    // Optional PHY pipeline thread (keeps &s->cfg: the Sim must not move)
+    s->pipe = NULL;
+    if (s->cfg.phy_mode == 1 && s->cfg.phy_pipeline && !s->cfg.phy_lazy) {
+        s->pipe = (PhyPipe*)calloc(1, sizeof(PhyPipe));
+        if (phypipe_start(s->pipe, &s->phy, &s->cfg) != 0) {
+            free(s->pipe);
+            s->pipe = NULL;
+        }
+    }
+
+    // Per-stage counters (clock-only when perf_event_open is refused)
+    s->perf = NULL;
+    if (s->cfg.perf_counters) {
+        s->perf = (PerfCtr*)calloc(1, sizeof(PerfCtr));
+        // The group counts this thread only: the carrier workers' PHY and
+        // EDF would show up as barrier waits, so keep the clock only
+        perfctr_open(s->perf, s->ca && s->ca->thr ? "carrier worker threads not counted" : NULL);
+    }
+
+    // Pick the step variant for this configuration once
+    s->step = sim_select_step(s);
 }
 
 void sim_free(Sim *s) {
@@ -93,28 +318,82 @@ void sim_free(Sim *s) {
         free(s->ues);
     }
     if (s->harq_events) free(s->harq_events);
-    if (s->csv) fclose(s->csv);
-    if (s->evcsv) fclose(s->evcsv);
-    if (s->chcsv) fclose(s->chcsv);
+    free(s->comps);
+    free(s->pend);
+    free(s->allocs);
+    free(s->fb);
+    metrics_free(&s->m);
+    trace_close(&s->trace);
+    if (s->ext) {
+        ext_sched_close(s->ext);
+        free(s->ext);
+        s->ext = NULL;
+    }
+    if (s->pipe) {
+        phypipe_stop(s->pipe);   // before phy_free: the thread uses s->phy
+        free(s->pipe);
+        s->pipe = NULL;
+    }
+    if (s->mu) {
+        mu_free(s->mu);          // borrows the Phy signatures
+        free(s->mu);
+        s->mu = NULL;
+    }
+    if (s->ca) {
+        carrier_free(s->ca);     // joins the carrier threads
+        free(s->ca);
+        s->ca = NULL;
+    }
+    if (s->perf) {
+        perfctr_close(s->perf);
+        free(s->perf);
+        s->perf = NULL;
+    }
     if (s->cfg.phy_mode == 1) phy_free(&s->phy);
 }
 
 // ----------------- Traffic + deadlines -----------------
 
-static void arrivals(Sim *s) {
+static int pending_cmp(const void *a, const void *b) {
+    const PendingPkt *x = (const PendingPkt*)a, *y = (const PendingPkt*)b;
+    if (x->p.arrival_us != y->p.arrival_us) return x->p.arrival_us < y->p.arrival_us ? -1 : 1;
+    return (x->ue_id > y->ue_id) - (x->ue_id < y->ue_id);
+}
+
+SIM_HOT void arrivals(Sim *s, const bool phy, const bool urllc) {
+    const long long t0 = (long long)s->tti * s->cfg.slot_us;
+    s->n_pend = s->pend_next = 0;
+
     // Bernoulli arrivals per UE
     for (int i = 0; i < s->cfg.num_ues; ++i) {
-        if (rng_uniform01() < s->cfg.arrival_rate) {
+        if (rng_uniform01() < s->p_embb) {
             Packet p = {
                 .bits = rng_int(s->cfg.pkt_bits_min, s->cfg.pkt_bits_max),
-                .arrival_tti = s->tti,
-                .deadline_tti = s->tti + s->cfg.deadline_ttis
+                .arrival_us = t0,
+                .deadline_us = t0 + s->cfg.deadline_us,
+                .cls = PKT_EMBB
             };
             (void)ue_queue_push(&s->ues[i], p);
             s->m.total_packets++;
+            s->m.cls_packets[PKT_EMBB]++;
+        }
+        // URLLC lands anywhere in the slot; only a mini-slot can serve it
+        // before the next slot boundary
+        if (urllc && rng_uniform01() < s->p_urllc) {
+            long long at = t0 + rng_int(0, s->cfg.slot_us - 1);
+            Packet p = {
+                .bits = s->cfg.urllc_bits,
+                .arrival_us = at,
+                .deadline_us = at + s->cfg.urllc_deadline_us,
+                .cls = PKT_URLLC
+            };
+            if (at == t0) (void)ue_queue_push_front(&s->ues[i], p);
+            else s->pend[s->n_pend++] = (PendingPkt){ .ue_id = i, .p = p };
+            s->m.total_packets++;
+            s->m.cls_packets[PKT_URLLC]++;
         }
         // Legacy random-walk CQI only when PHY is disabled
-        if (s->cfg.phy_mode == 0) {
+        if (!phy) {
             int delta = rng_int(-1, 1);
             s->ues[i].cqi += delta;
             if (s->ues[i].cqi < 1) s->ues[i].cqi = 1;
@@ -124,14 +403,24 @@ static void arrivals(Sim *s) {
             s->ues[i].rb_err_prob_cur = s->cfg.bler; // legacy uses BLER at TB level
         }
     }
+    if (s->n_pend > 1) qsort(s->pend, s->n_pend, sizeof(PendingPkt), pending_cmp);
+}
+
+// Queue the mid-slot URLLC arrivals that have happened by now_us
+static void release_pending(Sim *s, long long now_us) {
+    while (s->pend_next < s->n_pend && s->pend[s->pend_next].p.arrival_us <= now_us) {
+        const PendingPkt *pp = &s->pend[s->pend_next++];
+        (void)ue_queue_push_front(&s->ues[pp->ue_id], pp->p);
+    }
 }
 
 static void expire_deadlines(Sim *s) {
+    const long long now_us = (long long)s->tti * s->cfg.slot_us;
     // Count misses if HoL packet's deadline is before now
     for (int i = 0; i < s->cfg.num_ues; ++i) {
         UE *u = &s->ues[i];
         Packet p;
-        while (ue_queue_peek(u, &p) && p.deadline_tti < s->tti) {
+        while (ue_queue_peek(u, &p) && p.deadline_us < now_us) {
             metrics_on_miss(&s->m, &p);
             u->pkts_missed++;
             ue_queue_pop(u);
@@ -142,7 +431,20 @@ static void expire_deadlines(Sim *s) {
 // ----------------- HARQ ring helpers -----------------
 
 static bool harq_enqueue(Sim *s, HarqEvent ev) {
-    if (s->harq_count >= s->harq_cap) return false;
+    if (s->harq_count >= s->harq_cap) {
+        // Double and unwrap so head..tail stays contiguous from index 0
+        int cap = 2 * s->harq_cap;
+        HarqEvent *grown = (HarqEvent*)malloc((size_t)cap * sizeof(HarqEvent));
+        if (!grown) return false;
+        int first = s->harq_cap - s->harq_head;
+        memcpy(grown, s->harq_events + s->harq_head, (size_t)first * sizeof(HarqEvent));
+        memcpy(grown + first, s->harq_events, (size_t)s->harq_head * sizeof(HarqEvent));
+        free(s->harq_events);
+        s->harq_events = grown;
+        s->harq_head = 0;
+        s->harq_tail = s->harq_count;
+        s->harq_cap = cap;
+    }
     s->harq_events[s->harq_tail] = ev;
     s->harq_tail = (s->harq_tail + 1) % s->harq_cap;
     s->harq_count++;
@@ -152,7 +454,7 @@ static bool harq_enqueue(Sim *s, HarqEvent ev) {
 static bool harq_peek_due(Sim *s, HarqEvent *out) {
     if (s->harq_count == 0) return false;
     HarqEvent *ev = &s->harq_events[s->harq_head];
-    if (ev->tti_feedback != s->tti) return false;
+    if (ev->feedback_us > (long long)s->tti * s->cfg.slot_us) return false;
     *out = *ev;
     return true;
 }
@@ -163,14 +465,33 @@ static void harq_pop(Sim *s) {
     s->harq_count--;
 }
 
+// Record a HARQ outcome for this TTI's result view (and the events log)
+SIM_HOT void log_harq_event(Sim *s, EventKind kind, const HarqEvent *ev, int retx) {
+    if (s->n_fb == s->fb_cap) {
+        s->fb_cap *= 2;
+        s->fb = (HarqRecord*)realloc(s->fb, (size_t)s->fb_cap * sizeof(HarqRecord));
+    }
+    HarqRecord *r = &s->fb[s->n_fb++];
+    *r = (HarqRecord){
+        .tti = s->tti, .ue_id = ev->ue_id, .kind = kind,
+        .pkt_bits = ev->pkt_size_bits, .retx = retx,
+        .sinr_db = ev->sinr_db_at_tx, .cqi = ev->cqi_at_tx,
+        .rb_alloc = ev->rb_alloc, .rb_perr = ev->rb_err_prob_at_tx
+    };
+}
+
 // Process all HARQ feedback events due at current TTI.
 // If ACK -> count delivered; If NACK -> reinsert for retransmission.
-static void process_harq_feedback(Sim *s) {
+SIM_HOT void process_harq_feedback(Sim *s, const bool phy) {
     HarqEvent ev;
+    s->n_fb = 0;
     while (harq_peek_due(s, &ev)) {
         bool ack = false;
 
-        if (s->cfg.phy_mode == 1) {
+        if (ev.preempted) {
+            // Punctured by a URLLC mini-slot: the TB cannot decode
+            ack = false;
+        } else if (phy) {
             // RB-level errors: ACK only if all RBs succeed
             double per = ev.rb_err_prob_at_tx;
             int rb = ev.rb_alloc > 0 ? ev.rb_alloc : 1;
@@ -187,102 +508,209 @@ static void process_harq_feedback(Sim *s) {
         if (ack) {
             // Delivered at feedback time
             Packet tmp = { .bits = 0,
-                           .arrival_tti = ev.pkt_arrival_tti,
-                           .deadline_tti = ev.pkt_deadline_tti };
-            metrics_on_deliver(&s->m, &tmp, s->tti, ev.pkt_size_bits);
+                           .arrival_us = ev.pkt_arrival_us,
+                           .deadline_us = ev.pkt_deadline_us,
+                           .cls = ev.pkt_cls };
+            metrics_on_deliver(&s->m, ev.ue_id, &tmp, ev.feedback_us, ev.pkt_size_bits);
             s->ues[ev.ue_id].pkts_delivered++;
-
-            if (s->evcsv) {
-                fprintf(s->evcsv, "%d,ACK,%d,%d,%d,%.2f,%d,%d,%.6f\n",
-                        s->tti, ev.ue_id, ev.pkt_size_bits, ev.retx_count,
-                        ev.sinr_db_at_tx, ev.cqi_at_tx, ev.rb_alloc, ev.rb_err_prob_at_tx);
-            }
+            s->ues[ev.ue_id].bits_delivered += ev.pkt_size_bits;
+            log_harq_event(s, EV_ACK, &ev, ev.retx_count);
         } else {
             if (ev.retx_count >= 4) {
                 // Drop after max retries
                 Packet tmp = { .bits = ev.pkt_size_bits,
-                               .arrival_tti = ev.pkt_arrival_tti,
-                               .deadline_tti = ev.pkt_deadline_tti };
+                               .arrival_us = ev.pkt_arrival_us,
+                               .deadline_us = ev.pkt_deadline_us,
+                               .cls = ev.pkt_cls };
                 metrics_on_miss(&s->m, &tmp);
                 s->ues[ev.ue_id].pkts_missed++;
-
-                if (s->evcsv) {
-                    fprintf(s->evcsv, "%d,DROP,%d,%d,%d,%.2f,%d,%d,%.6f\n",
-                            s->tti, ev.ue_id, ev.pkt_size_bits, ev.retx_count,
-                            ev.sinr_db_at_tx, ev.cqi_at_tx, ev.rb_alloc, ev.rb_err_prob_at_tx);
-                }
+                log_harq_event(s, EV_DROP, &ev, ev.retx_count);
             } else {
                 // NACK -> reinsert for retransmission (push-front)
-                UE *u = &s->ues[ev.ue_id];
-                if (u->q_count < MAX_QUEUE) {
-                    u->q_head = (u->q_head - 1 + MAX_QUEUE) % MAX_QUEUE;
-                    u->q[u->q_head] = (Packet){
-                        .bits = ev.pkt_size_bits,
-                        .arrival_tti = ev.pkt_arrival_tti,
-                        .deadline_tti = ev.pkt_deadline_tti
-                    };
-                    u->q_count++;
-                } else {
+                Packet retx = { .bits = ev.pkt_size_bits,
+                                .arrival_us = ev.pkt_arrival_us,
+                                .deadline_us = ev.pkt_deadline_us,
+                                .cls = ev.pkt_cls };
+                if (!ue_queue_push_front(&s->ues[ev.ue_id], retx)) {
                     // queue full -> treat as miss
-                    Packet tmp = { .bits = ev.pkt_size_bits,
-                                   .arrival_tti = ev.pkt_arrival_tti,
-                                   .deadline_tti = ev.pkt_deadline_tti };
-                    metrics_on_miss(&s->m, &tmp);
+                    metrics_on_miss(&s->m, &retx);
                     s->ues[ev.ue_id].pkts_missed++;
-
-                    if (s->evcsv) {
-                        fprintf(s->evcsv, "%d,DROP,%d,%d,%d,%.2f,%d,%d,%.6f\n",
-                                s->tti, ev.ue_id, ev.pkt_size_bits, ev.retx_count,
-                                ev.sinr_db_at_tx, ev.cqi_at_tx, ev.rb_alloc, ev.rb_err_prob_at_tx);
-                    }
+                    log_harq_event(s, EV_DROP, &ev, ev.retx_count);
                     harq_pop(s);
-                    if (s->evcsv) fflush(s->evcsv);
                     continue;
                 }
-
-                if (s->evcsv) {
-                    fprintf(s->evcsv, "%d,NACK,%d,%d,%d,%.2f,%d,%d,%.6f\n",
-                            s->tti, ev.ue_id, ev.pkt_size_bits, ev.retx_count + 1,
-                            ev.sinr_db_at_tx, ev.cqi_at_tx, ev.rb_alloc, ev.rb_err_prob_at_tx);
-                }
+                log_harq_event(s, EV_NACK, &ev, ev.retx_count + 1);
             }
         }
         harq_pop(s);
-        if (s->evcsv) fflush(s->evcsv);
     }
 }
 
+// ----------------- PHY snapshot -----------------
+
+SIM_HOT void ue_set_instant(UE *u, const PhyUEInstant *inst) {
+    u->cqi            = inst->cqi;
+    u->bprb_cur       = inst->bits_per_rb;
+    u->sinr_db_cur    = inst->sinr_db;
+    u->rb_err_prob_cur= inst->rb_err_prob;
+}
+
+// Advance channel and take PHY snapshot for every UE
+SIM_HOT void phy_snapshot_all(Sim *s) {
+    // Snapshot was precomputed by the pipeline thread
+    const PhySnapshot *snap = s->pipe ? phypipe_acquire(s->pipe, s->tti) : NULL;
+    if (snap) {
+        for (int u = 0; u < s->cfg.num_ues; ++u) {
+            s->ues[u].cqi            = snap->cqi[u];
+            s->ues[u].bprb_cur       = snap->bits_per_rb[u];
+            s->ues[u].sinr_db_cur    = snap->sinr_db[u];
+            s->ues[u].rb_err_prob_cur= snap->rb_err_prob[u];
+        }
+        phypipe_release(s->pipe, s->tti);
+        return;
+    }
+
+    phy_step(&s->phy, &s->cfg, s->tti);
+    for (int u = 0; u < s->cfg.num_ues; ++u) {
+        PhyUEInstant inst;
+        phy_get_instant(&s->phy, &s->cfg, u, &inst);
+        ue_set_instant(&s->ues[u], &inst);
+    }
+}
+
+// Lazy channel: only UEs with queued data (or whose channel is logged this
+// TTI) are evaluated; the others keep a stale state that phy_advance_ue()
+// catches up in one draw when they next become active.
+SIM_HOT void phy_snapshot_active(Sim *s, const bool log_ch) {
+    const bool ch_on = log_ch && trace_tti_on(&s->trace, s->tti);
+    for (int u = 0; u < s->cfg.num_ues; ++u) {
+        bool logged = ch_on && trace_ue_on(&s->trace, u);
+        if (s->ues[u].q_count == 0 && !logged) continue;
+
+        PhyUEInstant inst;
+        phy_advance_ue(&s->phy, &s->cfg, u, s->tti);
+        phy_get_instant(&s->phy, &s->cfg, u, &inst);
+        ue_set_instant(&s->ues[u], &inst);
+    }
+
+    // UEs whose only data this slot is a mid-slot URLLC arrival
+    for (int i = 0; i < s->n_pend; ++i) {
+        int u = s->pend[i].ue_id;
+        if (s->phy.ue[u].last_tti == s->tti) continue;
+
+        PhyUEInstant inst;
+        phy_advance_ue(&s->phy, &s->cfg, u, s->tti);
+        phy_get_instant(&s->phy, &s->cfg, u, &inst);
+        ue_set_instant(&s->ues[u], &inst);
+    }
+}
+
+// Carrier aggregation: every carrier's channel on its own thread, after
+// arrivals and expiry so lazy mode sees the final queues.
+SIM_HOT void phy_snapshot_ca(Sim *s, const bool lazy, const bool log_ch) {
+    CarrierSet *cs = s->ca;
+    const bool ch_on = log_ch && trace_tti_on(&s->trace, s->tti);
+    if (lazy) {
+        for (int u = 0; u < s->cfg.num_ues; ++u)
+            cs->need[u] = s->ues[u].q_count > 0 || (ch_on && trace_ue_on(&s->trace, u));
+    }
+    carrier_phy(cs, s->tti, lazy);
+}
+
+// Channel log rows for this TTI, written after the snapshot so their cost
+// lands in the logging stage. Every logged UE was evaluated this TTI, even
+// in lazy mode. With carrier aggregation the log follows carrier 0 (the
+// primary cell).
+SIM_HOT void log_channel(Sim *s) {
+    if (!trace_tti_on(&s->trace, s->tti)) return;
+    if (s->ca) {
+        const Carrier *pc = &s->ca->cc[0];
+        for (int u = 0; u < s->cfg.num_ues; ++u) {
+            trace_channel(&s->trace, s->tti, u, pc->sinr_db[u], pc->cqi[u],
+                          pc->bprb[u], pc->perr[u]);
+        }
+        return;
+    }
+    for (int u = 0; u < s->cfg.num_ues; ++u) {
+        const UE *ue = &s->ues[u];
+        trace_channel(&s->trace, s->tti, u, ue->sinr_db_cur, ue->cqi,
+                      ue->bprb_cur, ue->rb_err_prob_cur);
+    }
+}
+
+// ----------------- Mini-slots -----------------
+
+// URLLC opportunities after the slot-level schedule: mini-slot k starts at
+// symbol k * syms (k = 0 is the slot itself). Each one first queues the
+// URLLC packets that have arrived by its start. Returns bits sent; the
+// free RBs used, counted in RB-symbols, are added to *rb_used in slot RBs.
+static int minislots(Sim *s, int n_slot, int *rb_used, int *comps_used) {
+    const int syms = s->cfg.minislot_syms;
+    const long long t0 = (long long)s->tti * s->cfg.slot_us;
+    const int rb_free = s->cfg.rb_total - *rb_used;
+    int rb_preempted = 0;
+    long long rb_syms = 0;
+    int bits = 0;
+
+    for (int k = 1; (k + 1) * syms <= 14; ++k) {
+        long long t = t0 + k * syms * s->cfg.slot_us / 14;
+        release_pending(s, t);
+
+        int from = *comps_used, rb_ms = 0;
+        bits += schedule_minislot(s->ues, s->cfg.num_ues, syms, rb_free, &rb_preempted,
+                                  s->cfg.preempt != 0, n_slot, &s->m, &rb_ms,
+                                  s->comps, s->comps_cap, comps_used);
+        for (int i = from; i < *comps_used; ++i) s->comps[i].tx_us = t;
+        rb_syms += (long long)(rb_ms < rb_free ? rb_ms : rb_free) * syms;
+    }
+    *rb_used += (int)((rb_syms + 13) / 14);
+    return bits;
+}
+
 // ----------------- One TTI -----------------
 
-void sim_step(Sim *s) {
+SIM_HOT void sim_step_impl(Sim *s, const bool phy, const bool urllc, const bool log_sched,
+                           const bool log_ev, const bool log_ch) {
+    if (s->perf) perfctr_start(s->perf);
+
     // Process ACK/NACKs arriving now
-    process_harq_feedback(s);
+    process_harq_feedback(s, phy);
+    PERF_MARK(s, PC_HARQ);
+    if (log_ev) {
+        for (int i = 0; i < s->n_fb; ++i) trace_event(&s->trace, &s->fb[i]);
+        PERF_MARK(s, PC_LOG);
+    }
 
-    // Advance channel and take PHY snapshot for each UE
-    if (s->cfg.phy_mode == 1) {
-        phy_step(&s->phy, &s->cfg, s->tti);
-        for (int u = 0; u < s->cfg.num_ues; ++u) {
-            PhyUEInstant inst;
-            phy_get_instant(&s->phy, &s->cfg, u, &inst);
-            s->ues[u].cqi            = inst.cqi;
-            s->ues[u].bprb_cur       = inst.bits_per_rb;
-            s->ues[u].sinr_db_cur    = inst.sinr_db;
-            s->ues[u].rb_err_prob_cur= inst.rb_err_prob;
-
-            if (s->chcsv) {
-                fprintf(s->chcsv, "%d,%d,%.2f,%d,%d,%.6f\n",
-                        s->tti, u, inst.sinr_db, inst.cqi, inst.bits_per_rb, inst.rb_err_prob);
-            }
+    const bool lazy = phy && s->cfg.phy_lazy;
+    if (phy && !lazy && !s->ca) {
+        phy_snapshot_all(s);
+        PERF_MARK(s, PC_PHY);
+        if (log_ch) {
+            log_channel(s);
+            PERF_MARK(s, PC_LOG);
         }
-        if (s->chcsv) fflush(s->chcsv);
     }
 
-    arrivals(s);
+    arrivals(s, phy, urllc);
+    PERF_MARK(s, PC_ARRIVALS);
     expire_deadlines(s);
+    PERF_MARK(s, PC_EXPIRY);
+
+    // Lazy PHY runs after the queues are final for this TTI
+    if (s->ca || lazy) {
+        if (s->ca) phy_snapshot_ca(s, lazy, log_ch);
+        else       phy_snapshot_active(s, log_ch);
+        PERF_MARK(s, PC_PHY);
+        if (log_ch) {
+            log_channel(s);
+            PERF_MARK(s, PC_LOG);
+        }
+    }
 
     // reset per-TTI debug flags
     for (int u = 0; u < s->cfg.num_ues; ++u) {
         s->ues[u].dbg_tx_bits_this_tti = 0;
+        s->ues[u].dbg_rb_this_tti      = 0;
         s->ues[u].dbg_was_scheduled    = 0;
     }
 
@@ -293,32 +721,59 @@ void sim_step(Sim *s) {
         printf("UE %02d: q=%d | deadlines(bits): ", u, ue->q_count);
         for (int k = 0, idx = ue->q_head; k < ue->q_count; ++k, idx = (idx + 1) % MAX_QUEUE) {
             Packet *pkt = &ue->q[idx];
-            printf("%d(%d) ", pkt->deadline_tti, pkt->bits);
+            printf("%lld(%d) ", pkt->deadline_us, pkt->bits);
         }
         printf("\n");
     }
 #endif
 
+    const long long t0 = (long long)s->tti * s->cfg.slot_us;
     int rb_used = 0;
-    Completion comps[256];
+    Completion *comps = s->comps;
     int comps_used = 0;
 
-    int bits = schedule_edf(s->ues, s->cfg.num_ues, s->cfg.rb_total, s->tti,
+    const Grant *grants;
+    int num_grants;
+    int bits;
+    if (s->ca) {
+        bits = carrier_schedule(s->ca, s->ues, &s->m, &rb_used,
+                                comps, s->comps_cap, &comps_used);
+    } else if (s->ext && ext_sched_exchange(s->ext, s->ues, s->cfg.num_ues, s->tti, s->cfg.rb_total,
+                                     &grants, &num_grants) == 0) {
+        bits = schedule_grants(s->ues, s->cfg.num_ues, grants, num_grants,
+                               s->cfg.rb_total, &rb_used,
+                               comps, s->comps_cap, &comps_used);
+    } else if (s->mu) {
+        bits = schedule_edf_mu(s->ues, s->cfg.num_ues, s->cfg.rb_total, t0,
+                               &s->m, s->mu, &rb_used,
+                               comps, s->comps_cap, &comps_used);
+    } else {
+        bits = schedule_edf(s->ues, s->cfg.num_ues, s->cfg.rb_total, t0,
                             &s->m, &rb_used,
-                            comps, 256, &comps_used);
+                            comps, s->comps_cap, &comps_used);
+    }
+    const int n_slot = comps_used;
+    for (int i = 0; i < n_slot; ++i) comps[i].tx_us = t0;
+
+    if (s->cfg.minislot_syms > 0) bits += minislots(s, n_slot, &rb_used, &comps_used);
+    // Arrivals no mini-slot picked up wait for the next slot
+    release_pending(s, LLONG_MAX);
 
     s->m.total_bits_sent += bits;
     s->m.rb_used_total   += rb_used;
+    PERF_MARK(s, PC_SCHED);
 
-    // Convert completions into HARQ feedback events
+    // Convert completions into HARQ feedback events (in TX time order)
     for (int i = 0; i < comps_used; ++i) {
         HarqEvent ev = {
             .ue_id = comps[i].ue_id,
-            .tti_feedback = s->tti + s->cfg.harq_rtt,
-            .pkt_arrival_tti = comps[i].pkt_arrival_tti,
-            .pkt_deadline_tti = comps[i].pkt_deadline_tti,
+            .feedback_us = comps[i].tx_us + s->cfg.harq_rtt_us,
+            .pkt_arrival_us = comps[i].pkt_arrival_us,
+            .pkt_deadline_us = comps[i].pkt_deadline_us,
             .pkt_size_bits = comps[i].pkt_size_bits,
+            .pkt_cls = comps[i].pkt_cls,
             .retx_count = 0,
+            .preempted = comps[i].preempted,
 
             .rb_alloc = comps[i].rb_alloc,
             .cqi_at_tx = comps[i].cqi_at_tx,
@@ -327,27 +782,33 @@ void sim_step(Sim *s) {
         };
         (void)harq_enqueue(s, ev);
     }
+    PERF_MARK(s, PC_HARQ);
 
-    // CSV: log per-UE allocations for this TTI
-    if (s->csv) {
-        for (int u = 0; u < s->cfg.num_ues; ++u) {
-            UE *ue = &s->ues[u];
-            if (!ue->dbg_was_scheduled) continue;
-            int bprb = (s->cfg.phy_mode==1 && ue->bprb_cur>0) ? ue->bprb_cur : bits_per_rb_for_cqi(ue->cqi);
-            int rb_used_est = (bprb > 0) ? (ue->dbg_tx_bits_this_tti / bprb) : 0;
-
-            int hol_deadline = 0;
-            if (ue->q_count > 0) {
-                Packet *p = &ue->q[ue->q_head];
-                hol_deadline = p->deadline_tti;
-            }
+    // Per-UE allocation records for this TTI (+ queue depth for metrics)
+    long long queued = 0;
+    s->n_allocs = 0;
+    for (int u = 0; u < s->cfg.num_ues; ++u) {
+        UE *ue = &s->ues[u];
+        queued += ue->q_count;
+        if (!ue->dbg_was_scheduled) continue;
+
+        s->allocs[s->n_allocs++] = (AllocRecord){
+            .tti = s->tti,
+            .ue_id = u,
+            .bits = ue->dbg_tx_bits_this_tti,
+            .rb = ue->dbg_rb_this_tti,
+            .cqi = ue->cqi,
+            .queue_after = ue->q_count,
+            .hol_deadline = ue->q_count > 0 ? ue->q[ue->q_head].deadline_us : 0
+        };
+    }
+    metrics_on_tti(&s->m, rb_used, queued);
 
-            fprintf(s->csv, "%d,%d,%d,%d,%d,%d,%d\n",
-                    s->tti, u, ue->dbg_tx_bits_this_tti, rb_used_est,
-                    ue->cqi, ue->q_count, hol_deadline);
-        }
-        fflush(s->csv);
+    // CSV: log per-UE allocations for this TTI
+    if (log_sched && trace_tti_on(&s->trace, s->tti)) {
+        for (int i = 0; i < s->n_allocs; ++i) trace_sched(&s->trace, &s->allocs[i]);
     }
+    PERF_MARK(s, PC_LOG);
 
 #if DEBUG_QUEUES
     printf("=== TTI %d: Packets Sent ===\n", s->tti);
@@ -363,19 +824,65 @@ void sim_step(Sim *s) {
         printf("UE %02d: q=%d | deadlines(bits): ", u, ue->q_count);
         for (int k = 0, idx = ue->q_head; k < ue->q_count; ++k, idx = (idx + 1) % MAX_QUEUE) {
             Packet *pkt = &ue->q[idx];
-            printf("%d(%d) ", pkt->deadline_tti, pkt->bits);
+            printf("%lld(%d) ", pkt->deadline_us, pkt->bits);
         }
         printf("\n");
     }
 #endif
 }
 
+// One variant per (phy_mode, URLLC traffic, schedule log, events log,
+// channel log). Lazy PHY, carriers, MU-MIMO, the external scheduler and
+// perf counters stay run-time checks: they are tested once per TTI, not
+// per UE.
+#define SIM_STEP_VARIANTS(X) \
+    X(0,0,0,0,0) X(0,0,0,0,1) X(0,0,0,1,0) X(0,0,0,1,1) \
+    X(0,0,1,0,0) X(0,0,1,0,1) X(0,0,1,1,0) X(0,0,1,1,1) \
+    X(0,1,0,0,0) X(0,1,0,0,1) X(0,1,0,1,0) X(0,1,0,1,1) \
+    X(0,1,1,0,0) X(0,1,1,0,1) X(0,1,1,1,0) X(0,1,1,1,1) \
+    X(1,0,0,0,0) X(1,0,0,0,1) X(1,0,0,1,0) X(1,0,0,1,1) \
+    X(1,0,1,0,0) X(1,0,1,0,1) X(1,0,1,1,0) X(1,0,1,1,1) \
+    X(1,1,0,0,0) X(1,1,0,0,1) X(1,1,0,1,0) X(1,1,0,1,1) \
+    X(1,1,1,0,0) X(1,1,1,0,1) X(1,1,1,1,0) X(1,1,1,1,1)
+
+#define SIM_STEP_DEFINE(phy, ur, ls, le, lc) \
+    static void sim_step_##phy##ur##ls##le##lc(Sim *s) { sim_step_impl(s, phy, ur, ls, le, lc); }
+SIM_STEP_VARIANTS(SIM_STEP_DEFINE)
+
+#define SIM_STEP_ENTRY(phy, ur, ls, le, lc) [phy][ur][ls][le][lc] = sim_step_##phy##ur##ls##le##lc,
+static SimStepFn const sim_step_table[2][2][2][2][2] = { SIM_STEP_VARIANTS(SIM_STEP_ENTRY) };
+
+// Reference path with the configuration checked at run time (--no-specialize)
+static void sim_step_generic(Sim *s) {
+    sim_step_impl(s, s->cfg.phy_mode == 1, s->p_urllc > 0.0, s->trace.sched != NULL,
+                  s->trace.ev != NULL, s->trace.ch != NULL);
+}
+
+static SimStepFn sim_select_step(const Sim *s) {
+    if (s->cfg.step_generic) return sim_step_generic;
+    return sim_step_table[s->cfg.phy_mode == 1][s->p_urllc > 0.0][s->trace.sched != NULL]
+                         [s->trace.ev != NULL][s->trace.ch != NULL];
+}
+
+void sim_step(Sim *s) {
+    s->step(s);
+}
+
 // ----------------- Run + summary -----------------
 
+static long long mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 void sim_run(Sim *s) {
-    for (s->tti = 0; s->tti < s->cfg.ttis; ++s->tti) {
+    // continues from the current TTI so stepwise callers can mix step/run
+    long long t0 = mono_ns();
+    for (; s->tti < s->cfg.ttis; ++s->tti) {
         sim_step(s);
     }
+    s->wall_ns += mono_ns() - t0;
 }
 
 void sim_print_summary(const Sim *s) {
@@ -390,7 +897,54 @@ void sim_print_summary(const Sim *s) {
     printf("Arrivals: %lld pkts\n", s->m.total_packets);
     printf("Bits sent: %lld bits (%.2f Mbits)\n", s->m.total_bits_sent, s->m.total_bits_sent / 1e6);
     printf("Deadline misses: %lld (%.2f%%)\n", s->m.deadline_misses, miss_rate * 100.0);
-    printf("Avg latency (TTIs) over delivered: %.2f\n", avg_latency);
+    printf("Avg latency (us) over delivered: %.1f\n", avg_latency);
+    printf("Latency p50/p99/p99.9 (us): %lld / %lld / %lld\n",
+           metrics_lat_us(&s->m, &s->m.lat, 0.50), metrics_lat_us(&s->m, &s->m.lat, 0.99),
+           metrics_lat_us(&s->m, &s->m.lat, 0.999));
+    static const char *cls_name[PKT_CLASSES] = { "eMBB", "URLLC" };
+    for (int c = 0; c < PKT_CLASSES; ++c) {
+        if (s->m.cls_packets[c] == 0) continue;
+        const LatHist *h = &s->m.cls_lat[c];
+        printf("  %-5s %lld pkts, misses %lld (%.2f%%), latency p50/p99 (us): %lld / %lld\n",
+               cls_name[c], s->m.cls_packets[c], s->m.cls_misses[c],
+               100.0 * (double)s->m.cls_misses[c] / (double)s->m.cls_packets[c],
+               metrics_lat_us(&s->m, h, 0.50), metrics_lat_us(&s->m, h, 0.99));
+    }
     double util = (double)s->m.rb_used_total / ((double)s->cfg.ttis * (double)s->cfg.rb_total);
     printf("RB utilization: %.2f%%\n", util * 100.0);
+    printf("Jain fairness (delivered bits): %.4f\n", metrics_jain_index(s->ues, s->cfg.num_ues));
+    if (s->ext) {
+        const LatHist *h = &s->ext->rtt_ns;
+        printf("Ext scheduler RTT p50/p99/p99.9 (us): %.1f / %.1f / %.1f, max %.1f\n",
+               lathist_quantile(h, 0.50) / 1e3, lathist_quantile(h, 0.99) / 1e3,
+               lathist_quantile(h, 0.999) / 1e3, h->max / 1e3);
+        printf("Ext scheduler fallbacks to EDF: %lld TTIs\n", s->ext->timeouts);
+    }
+    if (s->cfg.slot_us != 1000 || s->cfg.minislot_syms > 0) {
+        printf("Slot: %d us, mini-slot: %d symbols, eMBB TBs pre-empted: %lld\n",
+               s->cfg.slot_us, s->cfg.minislot_syms, s->m.preempted);
+    }
+    if (s->ca) {
+        double us = (double)(s->tti > 0 ? s->tti : 1) * s->cfg.slot_us;
+        for (int c = 0; c < s->ca->n; ++c) {
+            const Carrier *cc = &s->ca->cc[c];
+            printf("Carrier %d: %d RB, SNR offset %+.1f dB, RB utilization %.2f%%, "
+                   "throughput %.2f Mbit/s\n", c, cc->rb, cc->snr_off_db,
+                   100.0 * (double)s->m.ca_rb_used[c] / ((double)(s->tti > 0 ? s->tti : 1) * cc->rb),
+                   (double)s->m.ca_bits_sent[c] / us);
+        }
+    }
+    if (s->mu) {
+        printf("MU-MIMO pairs: %lld (%.2f per TTI)\n", s->m.mu_pairs,
+               (double)s->m.mu_pairs / (double)(s->tti > 0 ? s->tti : 1));
+    }
+    if (s->wall_ns > 0) {
+        printf("Wall time: %.1f ms (%.2f us/TTI)\n", s->wall_ns / 1e6,
+               s->wall_ns / 1e3 / (double)(s->tti > 0 ? s->tti : 1));
+    }
+    if (s->perf) perfctr_print(s->perf, s->cfg.num_ues);
+}
+
+int sim_write_summary(const Sim *s, const char *path) {
+    return metrics_write_json(&s->m, &s->cfg, s->ues, path);
 }
@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200809L
+#include "trace.h"
+#include <sys/stat.h>
+
+static const char *ev_name[] = { "ACK", "NACK", "DROP" };
+
+// xorshift64*: reservoir decisions must not consume the simulation RNG
+static uint64_t trace_rand(Trace *t) {
+    t->rng ^= t->rng >> 12;
+    t->rng ^= t->rng << 25;
+    t->rng ^= t->rng >> 27;
+    return t->rng * 0x2545F4914F6CDD1DULL;
+}
+
+int trace_parse_streams(const char *spec) {
+    int mask = 0;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        if (!strcmp(tok, "sched") || !strcmp(tok, "schedule")) mask |= LOG_SCHED;
+        else if (!strcmp(tok, "events")) mask |= LOG_EVENTS;
+        else if (!strcmp(tok, "channel")) mask |= LOG_CHANNEL;
+        else if (!strcmp(tok, "all")) mask |= LOG_ALL;
+        else if (!strcmp(tok, "none")) mask = 0;
+        else return -1;
+    }
+    return mask;
+}
+
+// "0-7,12,40-" -> mask; returns -1 on syntax error
+static int parse_ue_list(const char *spec, unsigned char *on, int num_ues) {
+    const char *p = spec;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi;
+        if (end == p) return -1;
+        p = end;
+        if (*p == '-') {
+            ++p;
+            hi = strtol(p, &end, 10);
+            if (end == p) hi = num_ues - 1;   // open range "40-"
+            p = end;
+        } else {
+            hi = lo;
+        }
+        if (lo < 0) lo = 0;
+        if (hi >= num_ues) hi = num_ues - 1;
+        for (long i = lo; i <= hi; ++i) on[i] = 1;
+        if (*p == ',') ++p;
+        else if (*p) return -1;
+    }
+    return 0;
+}
+
+static FILE *open_stream(const char *dir, const char *name, const char *header) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[warn] cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    fputs(header, f);
+    return f;
+}
+
+void trace_open(Trace *t, const Config *cfg) {
+    memset(t, 0, sizeof(*t));
+    t->every   = cfg->log_every > 1 ? cfg->log_every : 1;
+    t->num_ues = cfg->num_ues;
+
+    if (cfg->log_ues && *cfg->log_ues) {
+        t->ue_on = (unsigned char*)calloc(cfg->num_ues, 1);
+        if (parse_ue_list(cfg->log_ues, t->ue_on, cfg->num_ues) != 0) {
+            fprintf(stderr, "[warn] bad --log-ues '%s', logging all UEs\n", cfg->log_ues);
+            free(t->ue_on);
+            t->ue_on = NULL;
+        }
+    }
+
+    const char *dir = (cfg->out_dir && *cfg->out_dir) ? cfg->out_dir : ".";
+    if (cfg->log_streams) (void)mkdir(dir, 0755);   // EEXIST is fine
+
+    static const char *sched_hdr = "tti,ue,bits_sent,rb_used,cqi,queue_after,hol_deadline\n";
+    if (cfg->csv_path && *cfg->csv_path) {
+        // explicit --csv path wins over out_dir/schedule.csv
+        t->sched = fopen(cfg->csv_path, "w");
+        if (t->sched) fputs(sched_hdr, t->sched);
+        else fprintf(stderr, "[warn] cannot open %s: %s\n", cfg->csv_path, strerror(errno));
+    } else if (cfg->log_streams & LOG_SCHED) {
+        t->sched = open_stream(dir, "schedule.csv", sched_hdr);
+    }
+    if (cfg->log_streams & LOG_EVENTS) {
+        t->ev = open_stream(dir, "events.csv", "tti,event,ue,pkt_bits,retx,sinr_db,cqi,rb_alloc,rb_perr\n");
+        if (t->ev && cfg->log_sample > 0) {
+            t->res_cap = cfg->log_sample;
+            t->res = (HarqRecord*)malloc((size_t)t->res_cap * sizeof(HarqRecord));
+            t->rng = ((uint64_t)cfg->seed << 1) ^ 0x9E3779B97F4A7C15ULL;
+        }
+    }
+    if (cfg->log_streams & LOG_CHANNEL) {
+        t->ch = open_stream(dir, "channel.csv", "tti,ue,sinr_db,cqi,bits_per_rb,rb_err_prob\n");
+    }
+}
+
+static void write_event(FILE *f, const HarqRecord *e) {
+    fprintf(f, "%d,%s,%d,%d,%d,%.2f,%d,%d,%.6f\n",
+            e->tti, ev_name[e->kind], e->ue_id, e->pkt_bits, e->retx,
+            e->sinr_db, e->cqi, e->rb_alloc, e->rb_perr);
+}
+
+static int event_cmp(const void *a, const void *b) {
+    const HarqRecord *x = (const HarqRecord*)a, *y = (const HarqRecord*)b;
+    if (x->tti != y->tti) return x->tti < y->tti ? -1 : 1;
+    return (x->ue_id > y->ue_id) - (x->ue_id < y->ue_id);
+}
+
+void trace_close(Trace *t) {
+    if (!t) return;
+    if (t->ev && t->res) {
+        // emit the sample in time order so downstream tools can stream it
+        int n = t->res_seen < t->res_cap ? (int)t->res_seen : t->res_cap;
+        qsort(t->res, n, sizeof(HarqRecord), event_cmp);
+        for (int i = 0; i < n; ++i) write_event(t->ev, &t->res[i]);
+    }
+    if (t->sched) fclose(t->sched);
+    if (t->ev) fclose(t->ev);
+    if (t->ch) fclose(t->ch);
+    free(t->res);
+    free(t->ue_on);
+    memset(t, 0, sizeof(*t));
+}
+
+void trace_event(Trace *t, const HarqRecord *e) {
+    if (!t->ev || !trace_ue_on(t, e->ue_id)) return;
+    if (!t->res) {
+        write_event(t->ev, e);
+        return;
+    }
+    // Algorithm R: keep each of the n events seen so far with prob res_cap/n
+    long long n = t->res_seen++;
+    if (n < t->res_cap) {
+        t->res[n] = *e;
+    } else {
+        uint64_t j = trace_rand(t) % (uint64_t)(n + 1);
+        if (j < (uint64_t)t->res_cap) t->res[j] = *e;
+    }
+}
+
+void trace_sched(Trace *t, const AllocRecord *a) {
+    if (!trace_ue_on(t, a->ue_id)) return;
+    fprintf(t->sched, "%d,%d,%d,%d,%d,%d,%lld\n",
+            a->tti, a->ue_id, a->bits, a->rb, a->cqi, a->queue_after, (long long)a->hol_deadline);
+}
+
+void trace_channel(Trace *t, int tti, int ue, double sinr_db, int cqi, int bits_per_rb, double rb_err_prob) {
+    if (!trace_ue_on(t, ue)) return;
+    fprintf(t->ch, "%d,%d,%.2f,%d,%d,%.6f\n", tti, ue, sinr_db, cqi, bits_per_rb, rb_err_prob);
+}
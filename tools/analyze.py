@@ -1,109 +1,141 @@
 #!/usr/bin/env python3
-import pandas as pd
+# Plots the simulator traces. The heavy lifting (one streaming pass over
+# schedule/events/channel CSVs of any size) is done by bin/l1stat; this script
+# only reads its small stat_*.csv outputs, so memory use stays flat.
+import csv
+import os
+import subprocess
+import sys
+from collections import defaultdict
+
+import matplotlib
+matplotlib.use("Agg")
 import matplotlib.pyplot as plt
-import sys, os
 
-path = sys.argv[1] if len(sys.argv) > 1 else "data/schedule.csv"
-if not os.path.exists(path):
-    raise SystemExit(f"CSV not found: {path}")
+arg = sys.argv[1] if len(sys.argv) > 1 else "data/schedule.csv"
+if os.path.isdir(arg):
+    trace_dir, sched_path = arg, os.path.join(arg, "schedule.csv")
+else:
+    trace_dir, sched_path = os.path.dirname(arg) or ".", arg
+if not os.path.exists(sched_path):
+    raise SystemExit(f"CSV not found: {sched_path}")
+
+repo = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+l1stat = os.path.join(repo, "bin", "l1stat")
+if not os.path.exists(l1stat):
+    raise SystemExit(f"{l1stat} not found: run 'make' first")
+subprocess.run([l1stat, "--dir", trace_dir, "--schedule", sched_path, "--out", trace_dir],
+               check=True, stdout=subprocess.DEVNULL)
+
+
+def read_rows(name):
+    path = os.path.join(trace_dir, name)
+    with open(path, newline="") as f:
+        return list(csv.DictReader(f))
+
+
+def save(name):
+    path = os.path.join(trace_dir, name)
+    plt.tight_layout()
+    plt.savefig(path)
+    plt.close()
+    print(f"  {path}")
+
+
+tti_rows = read_rows("stat_tti.csv")
+ue_rows = read_rows("stat_ue.csv")
+cqi_rows = read_rows("stat_cqi_sinr.csv")
 
-df = pd.read_csv(path)
-if df.empty:
+sched = [r for r in tti_rows if r["rb_used"] != ""]
+events = [r for r in tti_rows if r["ack"] != ""]
+channel = [r for r in tti_rows if r["perr_mean"] != ""]
+if not sched:
     raise SystemExit("CSV is empty")
 
+ue_rb = defaultdict(lambda: ([], []))
+ue_sinr = defaultdict(lambda: ([], []))
+for r in ue_rows:
+    t, ue = int(r["tti"]), int(r["ue"])
+    if r["rb_used"] != "":
+        ue_rb[ue][0].append(t)
+        ue_rb[ue][1].append(int(r["rb_used"]))
+    if r["sinr_db"] != "":
+        ue_sinr[ue][0].append(t)
+        ue_sinr[ue][1].append(float(r["sinr_db"]))
+
+print("Wrote:")
+
 # ---------- 1) Total RB utilization per TTI ----------
-util = df.groupby("tti")["rb_used"].sum()
 plt.figure()
-util.plot()
+plt.plot([int(r["tti"]) for r in sched], [int(r["rb_used"]) for r in sched])
 plt.xlabel("TTI")
 plt.ylabel("RBs used")
 plt.title("Total RB utilization per TTI")
-plt.tight_layout()
-plt.savefig("data/plot_utilization.png")
-
-# ---------- 2) Per-UE RBs (first 6 UEs) ----------
-sample = sorted(df["ue"].unique())[:6]
-pivot = df[df["ue"].isin(sample)].pivot_table(
-    index="tti", columns="ue", values="rb_used", aggfunc="sum", fill_value=0
-)
+save("plot_utilization.png")
+
+# ---------- 2) Per-UE RBs (sample UEs) ----------
 plt.figure()
-pivot.plot()
+for ue in sorted(ue_rb):
+    plt.plot(*ue_rb[ue], label=str(ue))
+plt.legend(title="ue")
 plt.xlabel("TTI")
 plt.ylabel("RBs used")
 plt.title("Per-UE RB allocation (sample)")
-plt.tight_layout()
-plt.savefig("data/plot_per_ue.png")
+save("plot_per_ue.png")
 
 # ---------- 3) Queue pressure (avg queue len after scheduling) ----------
-qavg = df.groupby("tti")["queue_after"].mean()
 plt.figure()
-qavg.plot()
+plt.plot([int(r["tti"]) for r in sched], [float(r["queue_mean"]) for r in sched])
 plt.xlabel("TTI")
 plt.ylabel("Avg queue length (post-sched)")
 plt.title("Queue pressure over time")
-plt.tight_layout()
-plt.savefig("data/plot_queue_pressure.png")
-
-print("Wrote:")
-print("  data/plot_utilization.png")
-print("  data/plot_per_ue.png")
-print("  data/plot_queue_pressure.png")
+save("plot_queue_pressure.png")
 
 # ---------- 4) HARQ events ----------
-ev_path = "data/events.csv"
-if os.path.exists(ev_path):
-    ev = pd.read_csv(ev_path)
-    if not ev.empty:
-        counts = ev.groupby(["tti","event"]).size().unstack(fill_value=0)
-        plt.figure()
-        counts.plot()
-        plt.xlabel("TTI")
-        plt.ylabel("Count")
-        plt.title("HARQ events per TTI (ACK/NACK/DROP)")
-        plt.tight_layout()
-        plt.savefig("data/plot_harq_events.png")
-        print("  data/plot_harq_events.png")
+if events:
+    x = [int(r["tti"]) for r in events]
+    plt.figure()
+    for kind in ("ack", "drop", "nack"):
+        plt.plot(x, [int(r[kind]) for r in events], label=kind.upper())
+    plt.legend(title="event")
+    plt.xlabel("TTI")
+    plt.ylabel("Count")
+    plt.title("HARQ events per TTI (ACK/NACK/DROP)")
+    save("plot_harq_events.png")
 
 # ---------- 5) Channel snapshots (if present) ----------
-ch_path = "data/channel.csv"
-if os.path.exists(ch_path):
-    ch = pd.read_csv(ch_path)
-    if not ch.empty:
-        # SINR per-UE (first 6 UEs)
-        ch_sample = ch[ch["ue"].isin(sample)]
-        pivot_sinr = ch_sample.pivot_table(index="tti", columns="ue", values="sinr_db", aggfunc="last")
-        plt.figure()
-        pivot_sinr.plot()
-        plt.xlabel("TTI")
-        plt.ylabel("SINR (dB)")
-        plt.title("Per-UE SINR over time (sample)")
-        plt.tight_layout()
-        plt.savefig("data/plot_sinr_per_ue.png")
-        print("  data/plot_sinr_per_ue.png")
-
-        # CQI vs SINR scatter
-        plt.figure()
-        ch.plot.scatter(x="sinr_db", y="cqi", alpha=0.3)
-        plt.xlabel("SINR (dB)")
-        plt.ylabel("CQI")
-        plt.title("CQI vs SINR")
-        plt.tight_layout()
-        plt.savefig("data/plot_cqi_vs_sinr.png")
-        print("  data/plot_cqi_vs_sinr.png")
-
-        # RB error prob and NACK overlay (per TTI)
-        if os.path.exists(ev_path):
-            ev = pd.read_csv(ev_path)
-            if not ev.empty:
-                nack = ev[ev["event"]=="NACK"].groupby("tti").size()
-                perr = ch.groupby("tti")["rb_err_prob"].mean()
-                ax = perr.plot()
-                ax2 = ax.twinx()
-                nack.plot(ax=ax2, style=".", label="NACK count")
-                ax.set_xlabel("TTI")
-                ax.set_ylabel("Avg RB error prob")
-                ax2.set_ylabel("NACKs")
-                ax.set_title("RB error probability vs NACKs")
-                plt.tight_layout()
-                plt.savefig("data/plot_perr_vs_nacks.png")
-                print("  data/plot_perr_vs_nacks.png")
+if channel:
+    # SINR per-UE (sample UEs)
+    plt.figure()
+    for ue in sorted(ue_sinr):
+        plt.plot(*ue_sinr[ue], label=str(ue))
+    plt.legend(title="ue")
+    plt.xlabel("TTI")
+    plt.ylabel("SINR (dB)")
+    plt.title("Per-UE SINR over time (sample)")
+    save("plot_sinr_per_ue.png")
+
+    # CQI vs SINR (0.5 dB bins, marker area ~ log count)
+    plt.figure()
+    counts = [int(r["count"]) for r in cqi_rows]
+    sizes = [4 + 6 * (c.bit_length()) for c in counts]
+    plt.scatter([float(r["sinr_db"]) for r in cqi_rows], [int(r["cqi"]) for r in cqi_rows],
+                s=sizes, alpha=0.3)
+    plt.xlabel("SINR (dB)")
+    plt.ylabel("CQI")
+    plt.title("CQI vs SINR")
+    save("plot_cqi_vs_sinr.png")
+
+    # RB error prob and NACK overlay (per TTI)
+    if events:
+        fig, ax = plt.subplots()
+        ax.plot([int(r["tti"]) for r in channel], [float(r["perr_mean"]) for r in channel])
+        ax2 = ax.twinx()
+        nacks = [r for r in events if int(r["nack"]) > 0]
+        ax2.plot([int(r["tti"]) for r in nacks], [int(r["nack"]) for r in nacks], ".",
+                 label="NACK count")
+        ax.set_xlabel("TTI")
+        ax.set_ylabel("Avg RB error prob")
+        ax2.set_ylabel("NACKs")
+        ax.set_title("RB error probability vs NACKs")
+        save("plot_perr_vs_nacks.png")